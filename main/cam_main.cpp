@@ -14,6 +14,8 @@
 #include "fb_gfx.h"
 #include "fd_forward.h" 
 #include "fr_forward.h"
+#include "neural_pipeline.h"
+#include "sentinel_wire.h"
 #include "soc/soc.h"
 #include "soc/rtc_cntl_reg.h"
 
@@ -22,8 +24,68 @@
  * Version: 4.1.0 "NEURAL ARMOR & ANALYTICS"
  * 
  * Hardware: AI-Thinker ESP32-CAM
+ * 
+ * Every camera is built from this one source. CAM_UNIT (1-4) picks the
+ * sector identity and CAM_UPLINK the hub it reports to; cam_main2-4.cpp and
+ * braincam1-4.cc only set those two and include this file.
  */
 
+// ==========================================================
+// 🪪 UNIT PROFILE
+// ==========================================================
+// A feature a profile leaves off is never set up: its routes are not
+// registered, its task hooks are skipped and its PSRAM buffers are never
+// allocated. This is not template code, so `if constexpr` only folds the
+// branch; the code is still compiled and linked, and the feature's static
+// state stays behind, idle (/status and /metrics report it as empty).
+enum UplinkTransport : uint8_t {
+    UPLINK_CORE,        // core_main.cpp: AsyncWebSocket on :80/ws, plus ESP-NOW
+    UPLINK_BRAIN,       // brain.cc: WebSocketsServer on :81/
+};
+
+#ifndef CAM_UNIT
+#define CAM_UNIT    1
+#endif
+#ifndef CAM_UPLINK
+#define CAM_UPLINK  UPLINK_CORE
+#endif
+
+struct CamProfile {
+    int id;
+    const char * sector;
+    uint8_t ipOctet;            // 192.168.4.x on PyramidNet
+    const char * hostname;      // mDNS name
+    bool streaming;             // /stream viewers and the adaptive stream controller
+    bool clips;                 // PSRAM pre-event ring and /clip
+    bool rawCapture;            // Sensor delivers RGB565 to the detector; JPEG encoded only when wanted
+    bool knownFaces;            // Enrolled people are recognised once per track and never alert
+    // Filled in by withUplink()
+    UplinkTransport uplink = UPLINK_CORE;
+    uint16_t uplinkPort = 80;
+    const char * uplinkPath = "/ws";
+    bool espNow = false;        // Heartbeat/stats/alert frames over ESP-NOW
+};
+
+constexpr CamProfile CAM_PROFILES[] = {
+    // id  sector   ip  hostname        stream clips  raw    faces
+    {1,    "NORTH", 2,  "pyramid-cam1", true,  true,  true,  true},
+    {2,    "EAST",  3,  "pyramid-cam2", true,  true,  true,  true},
+    {3,    "SOUTH", 4,  "pyramid-cam3", true,  true,  true,  true},
+    {4,    "WEST",  5,  "pyramid-cam4", true,  false, true,  false},  // Gate camera: alerts only
+};
+
+constexpr CamProfile withUplink(CamProfile p, UplinkTransport uplink) {
+    p.uplink = uplink;
+    p.uplinkPort = (uplink == UPLINK_CORE) ? 80 : 81;
+    p.uplinkPath = (uplink == UPLINK_CORE) ? "/ws" : "/";
+    p.espNow = (uplink == UPLINK_CORE);
+    return p;
+}
+
+static_assert(CAM_UNIT >= 1 && CAM_UNIT <= 4, "CAM_UNIT must be 1-4");
+constexpr CamProfile PROFILE = withUplink(CAM_PROFILES[CAM_UNIT - 1], CAM_UPLINK);
+static_assert(PROFILE.uplink == UPLINK_BRAIN || PROFILE.id <= 3, "core_main.cpp only serves cameras 1-3");
+
 // ==========================================================
 // 📍 HARDWARE PINS (STRICT AI-THINKER STANDARD)
 // ==========================================================
@@ -52,10 +114,10 @@
 const char* WIFI_SSID   = "PyramidNet";
 const char* WIFI_PASS   = "pointbreak";
 const char* BRAIN_IP    = "192.168.4.1";
-const int CAM_ID        = 1;
-const char* SECTOR      = "NORTH";
+const int CAM_ID        = PROFILE.id;
+const char* SECTOR      = PROFILE.sector;
 
-IPAddress local_IP(192, 168, 4, 2);
+IPAddress local_IP(192, 168, 4, PROFILE.ipOctet);
 IPAddress gateway(192, 168, 4, 1);
 IPAddress subnet(255, 255, 255, 0);
 
@@ -74,26 +136,105 @@ struct MachineHealth {
     uint32_t uptime;
 } health;
 
+// ==========================================================
+// 📈 LATENCY HISTOGRAMS
+// ==========================================================
+// Every stage of the detection and stream paths is timed with esp_timer and
+// counted into fixed power-of-two buckets (LAT_BUCKET_BASE_US x 2^i), cheap
+// enough to record on every frame. /metrics exports them as Prometheus
+// histograms, with p50/p95/p99 estimated from the buckets.
+#define LAT_BUCKETS         15      // Upper bounds 100us .. 1.64s, then +Inf
+#define LAT_BUCKET_BASE_US  100
+
+enum LatencyStage {
+    LAT_SENSOR,         // esp_camera_fb_get() in the capture task
+    LAT_ENCODE,         // JPEG encode of a raw frame for viewers
+    LAT_CAPTURE,        // Neural kernel waiting for a new frame
+    LAT_GATE,
+    LAT_DECODE,
+    LAT_DETECT,
+    LAT_RECOGNIZE,      // Align + embed + table search for one new track
+    LAT_BURST,          // Hub burst command received -> first burst inference done
+    LAT_SERIALIZE,      // Building alert / telemetry records
+    LAT_SEND,           // Handing a digest or ESP-NOW frame to the network
+    LAT_FRAME,          // Whole detection frame
+    LAT_STREAM_CHUNK,   // One /stream send (queueing a part into lwIP)
+    LAT_STREAM_FRAME,   // One /stream part, first byte queued to last byte ACKed
+    LAT_STAGES
+};
+
+const char * const LAT_STAGE_NAMES[LAT_STAGES] = {
+    "sensor", "encode", "capture", "gate", "decode", "detect", "recognize",
+    "burst", "serialize", "send", "frame", "stream_chunk", "stream_frame",
+};
+
+struct LatencyHistogram {
+    uint32_t buckets[LAT_BUCKETS + 1] = {0};    // The last one is +Inf
+    uint32_t count = 0;
+    uint64_t sumUs = 0;
+    uint32_t maxUs = 0;
+};
+
+LatencyHistogram latency[LAT_STAGES];
+portMUX_TYPE latencyMux = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t latencyBound(int bucket) {
+    return (uint32_t)LAT_BUCKET_BASE_US << bucket;
+}
+
+void recordLatency(LatencyStage stage, int64_t us) {
+    if (us < 0) return;
+    int b = 0;
+    while (b < LAT_BUCKETS && us > latencyBound(b)) b++;
+    portENTER_CRITICAL(&latencyMux);
+    LatencyHistogram &h = latency[stage];
+    h.buckets[b]++;
+    h.count++;
+    h.sumUs += us;
+    if (us > h.maxUs) h.maxUs = us;
+    portEXIT_CRITICAL(&latencyMux);
+}
+
+// Quantile from the buckets, interpolated linearly inside the bucket it falls in.
+uint32_t latencyQuantile(const LatencyHistogram &h, float q) {
+    if (!h.count) return 0;
+    uint32_t rank = max(1.0f, ceilf(q * h.count));
+    uint32_t seen = 0;
+    for (int b = 0; b <= LAT_BUCKETS; b++) {
+        if (h.buckets[b] && seen + h.buckets[b] >= rank) {
+            uint32_t lo = b ? latencyBound(b - 1) : 0;
+            uint32_t hi = (b < LAT_BUCKETS) ? min(latencyBound(b), h.maxUs) : h.maxUs;
+            return lo + (uint64_t)(hi - lo) * (rank - seen) / h.buckets[b];
+        }
+        seen += h.buckets[b];
+    }
+    return h.maxUs;
+}
+
 // ==========================================================
 // 📡 ESP-NOW PROTOCOL (ULTRA-LOW LATENCY)
 // ==========================================================
-typedef struct {
-    int id;
-    int type; // 0=HEARTBEAT, 1=ALERT
-    float temp;
-    uint32_t heap;
-} esp_now_data_t;
+// Records are batched into one sentinel_wire.h frame: heartbeat and stats go
+// out together every TELEMETRY_MS, an alert flushes the frame at once.
+// Only the core uplink listens for these (PROFILE.espNow).
 
 uint8_t brain_mac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}; // Broadcast
 
-void sendEspNow(int type) {
-    esp_now_data_t data;
-    data.id = CAM_ID;
-    data.type = type;
-    data.temp = health.temperature;
-    data.heap = health.freeHeap;
-    
-    esp_now_send(brain_mac, (uint8_t *) &data, sizeof(data));
+WireWriter espnowOut;           // Only touched by the neural kernel task
+
+void flushEspNow() {
+    if (!espnowOut.records) return;
+    size_t len = wireFinish(espnowOut, CAM_ID, millis());
+    int64_t start = esp_timer_get_time();
+    esp_now_send(brain_mac, espnowOut.buf, len);
+    recordLatency(LAT_SEND, esp_timer_get_time() - start);
+    wireBegin(espnowOut);
+}
+
+void queueEspNow(uint8_t type, const void * payload, size_t len) {
+    if (wireAppend(espnowOut, type, payload, len)) return;
+    flushEspNow();
+    wireAppend(espnowOut, type, payload, len);
 }
 
 // Global Objects
@@ -101,26 +242,398 @@ AsyncWebServer server(80);
 WebSocketsClient webSocket;
 TaskHandle_t AI_Task_Handle;
 volatile int activeStreams = 0; 
-int humanVerificationCounter = 0; 
 
 // ==========================================================
 // 🌡️ THERMAL GOVERNOR
 // ==========================================================
-extern "C" uint8_t temprature_sens_read();
+// Closed loop on the filtered die temperature: every THERMAL_STEP_MS the
+// throttle level moves one step up while above the setpoint band and one
+// step down while below it. Each level trims detection fps, stream fps,
+// sensor XCLK and CPU clock a little further, so coverage degrades smoothly
+// instead of stopping. Only past THERMAL_LIMIT at the last level does the
+// kernel skip detection (COOLING), and even then nothing blocks.
+#define THERMAL_SETPOINT    68.0    // °C the governor steers toward
+#define THERMAL_BAND        2.0     // Dead band either side of the setpoint
+#define THERMAL_LIMIT       82.0    // Headroom is reported against this
+#define THERMAL_STEP_MS     4000    // The die lags the load, so step slowly
+#define THERMAL_FILTER      0.2f    // EWMA weight of a new reading
+
+struct ThrottleStep {
+    float detectScale;          // Share of the DETECT_FPS_* targets
+    uint8_t streamFpsMax;
+    uint8_t xclkMhz;
+    uint16_t cpuMhz;
+};
+
+const ThrottleStep THROTTLE_STEPS[] = {
+    {1.00f, 15, 20, 240},
+    {0.75f, 12, 20, 240},
+    {0.60f, 10, 16, 240},
+    {0.50f,  8, 16, 160},
+    {0.35f,  5, 10, 160},
+    {0.20f,  3, 10, 160},
+};
+#define THROTTLE_LEVELS     (int)(sizeof(THROTTLE_STEPS) / sizeof(THROTTLE_STEPS[0]))
+
+struct ThermalGovernor {
+    float filtered = 0;
+    int level = 0;
+    uint32_t lastStep = 0;
+    uint32_t steps = 0;         // Level changes since boot
+    uint8_t xclkMhz = 20;       // What loop() last applied
+    uint16_t cpuMhz = 240;
+} thermal;
+
+const ThrottleStep &throttle() {
+    return THROTTLE_STEPS[thermal.level];
+}
 
+float thermalHeadroom() {
+    return THERMAL_LIMIT - thermal.filtered;
+}
+
+// Called by the neural kernel every frame.
 void runThermalCheck() {
-    health.temperature = temprature_sens_read();
+    health.temperature = temperatureRead();
     health.freeHeap = ESP.getFreeHeap();
     health.minFreeHeap = ESP.getMinFreeHeap();
-    
-    if (health.temperature > 82.0) {
+
+    thermal.filtered = thermal.filtered ? thermal.filtered * (1 - THERMAL_FILTER) + health.temperature * THERMAL_FILTER : health.temperature;
+    if (millis() - thermal.lastStep >= THERMAL_STEP_MS) {
+        thermal.lastStep = millis();
+        int level = thermal.level;
+        if (thermal.filtered > THERMAL_SETPOINT + THERMAL_BAND && level < THROTTLE_LEVELS - 1) level++;
+        else if (thermal.filtered < THERMAL_SETPOINT - THERMAL_BAND && level > 0) level--;
+        if (level != thermal.level) {
+            thermal.level = level;
+            thermal.steps++;
+            Serial.printf(">>> THERMAL GOVERNOR: LEVEL %d (%.1f C)\n", level, thermal.filtered);
+        }
+    }
+
+    bool critical = thermal.level == THROTTLE_LEVELS - 1 && thermalHeadroom() < 0;
+    if (critical && currentState != COOLING) {
         currentState = COOLING;
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-    } else if (health.temperature > 72.0) {
-        // Throttling handled by delay
-    } else {
-        if (currentState == COOLING) currentState = IDLE;
+        Serial.println(">>> CRITICAL THERMAL EVENT: DETECTION PAUSED");
+    } else if (!critical && currentState == COOLING) {
+        currentState = IDLE;
+    }
+}
+
+// Called from loop(): clock changes stay out of the capture and neural tasks.
+void applyThermalLimits() {
+    const ThrottleStep &step = throttle();
+    if (step.cpuMhz != thermal.cpuMhz) {
+        setCpuFrequencyMhz(step.cpuMhz);
+        thermal.cpuMhz = step.cpuMhz;
+    }
+    if (step.xclkMhz != thermal.xclkMhz) {
+        sensor_t * s = esp_camera_sensor_get();
+        if (s && s->set_xclk) s->set_xclk(s, LEDC_TIMER_0, step.xclkMhz);
+        thermal.xclkMhz = step.xclkMhz;
+    }
+}
+
+// ==========================================================
+// 📸 FRAME BROKER (SINGLE CAPTURE, SHARED READERS)
+// ==========================================================
+// One capture task owns esp_camera_fb_get(). Every frame is published into a
+// refcounted slot; stream clients and the neural kernel take references on
+// the latest frame, and the driver buffer is only returned once the last
+// reader (or the broker itself, on the next publish) lets go of it.
+// Viewers read `jpg`, which is the driver buffer itself in JPEG mode and
+// the slot's own encode buffer (or nothing) when the sensor runs raw.
+#define BROKER_SLOTS 4    // >= fb_count + 1
+
+struct BrokerFrame {
+    camera_fb_t * fb = nullptr;
+    uint32_t seq = 0;
+    int refs = 0;
+    const uint8_t * jpg = nullptr;
+    size_t jpgLen = 0;
+    uint8_t * encodeBuf = nullptr;  // Raw capture: JPEG_SLOT_BYTES owned by this slot
+};
+
+struct FrameBroker {
+    BrokerFrame slots[BROKER_SLOTS];
+    BrokerFrame * latest = nullptr;
+    uint32_t seq = 0;
+    uint32_t published = 0;
+    uint32_t dropped = 0;       // Frames returned at once because no slot was free
+    bool holdLatest = true;     // False on single-buffer rigs (no PSRAM)
+    bool rawCapture = false;    // Sensor frames are RGB565, not JPEG
+} broker;
+
+portMUX_TYPE brokerMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t Capture_Task_Handle;
+
+// Park a driver frame in a free slot; nullptr (frame already returned) if none is free.
+// Unreferenced slots are only touched by the capture task, so filling one needs no lock.
+BrokerFrame * claimSlot(camera_fb_t * fb) {
+    portENTER_CRITICAL(&brokerMux);
+    BrokerFrame * slot = nullptr;
+    for (int i = 0; i < BROKER_SLOTS; i++) {
+        if (broker.slots[i].refs == 0) { slot = &broker.slots[i]; break; }
+    }
+    if (!slot) broker.dropped++;
+    portEXIT_CRITICAL(&brokerMux);
+    if (!slot) {
+        esp_camera_fb_return(fb);
+        return nullptr;
+    }
+    slot->fb = fb;
+    bool jpeg = fb->format == PIXFORMAT_JPEG;
+    slot->jpg = jpeg ? fb->buf : nullptr;
+    slot->jpgLen = jpeg ? fb->len : 0;
+    return slot;
+}
+
+void publishFrame(BrokerFrame * slot) {
+    camera_fb_t * stale = nullptr;
+    portENTER_CRITICAL(&brokerMux);
+    slot->seq = ++broker.seq;
+    slot->refs = 1;             // The broker's own reference
+    BrokerFrame * previous = broker.latest;
+    broker.latest = slot;
+    broker.published++;
+    if (previous && --previous->refs == 0) {
+        stale = previous->fb;
+        previous->fb = nullptr;
+    }
+    portEXIT_CRITICAL(&brokerMux);
+    if (stale) esp_camera_fb_return(stale);
+}
+
+// Reference the latest frame if it is newer than `afterSeq` (and has a JPEG
+// when `needJpeg`), else nullptr.
+BrokerFrame * acquireFrame(uint32_t afterSeq, bool needJpeg = false) {
+    BrokerFrame * frame = nullptr;
+    portENTER_CRITICAL(&brokerMux);
+    if (broker.latest && broker.latest->seq != afterSeq && (!needJpeg || broker.latest->jpg)) {
+        frame = broker.latest;
+        frame->refs++;
+    }
+    portEXIT_CRITICAL(&brokerMux);
+    return frame;
+}
+
+void releaseFrame(BrokerFrame * frame) {
+    if (!frame) return;
+    camera_fb_t * stale = nullptr;
+    portENTER_CRITICAL(&brokerMux);
+    if (--frame->refs == 0) {
+        stale = frame->fb;
+        frame->fb = nullptr;
+    }
+    portEXIT_CRITICAL(&brokerMux);
+    if (stale) esp_camera_fb_return(stale);
+}
+
+// Blocking variant for tasks that may sleep (never call from async_tcp).
+BrokerFrame * waitFrame(uint32_t afterSeq, uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (true) {
+        BrokerFrame * frame = acquireFrame(afterSeq);
+        if (frame || millis() - start >= timeoutMs) return frame;
+        vTaskDelay(5 / portTICK_PERIOD_MS);
+    }
+}
+
+// Drop the broker's own reference so an unread latest frame goes back to the driver.
+void retireLatest() {
+    camera_fb_t * stale = nullptr;
+    portENTER_CRITICAL(&brokerMux);
+    BrokerFrame * previous = broker.latest;
+    broker.latest = nullptr;
+    if (previous && --previous->refs == 0) {
+        stale = previous->fb;
+        previous->fb = nullptr;
+    }
+    portEXIT_CRITICAL(&brokerMux);
+    if (stale) esp_camera_fb_return(stale);
+}
+
+// ==========================================================
+// 🎚️ ADAPTIVE STREAM CONTROLLER
+// ==========================================================
+// Each viewer is paced from how long its frames take to be ACKed in full
+// (parts go out zero-copy, so this is the true drain time of the link) and
+// from the send-buffer space seen at frame start, and skips whatever frames
+// it cannot take. The sensor is shared with the detector, so its frame size
+// never follows a viewer: it stays at the boot size the detector buffers
+// were sized for. Only JPEG quality follows the slowest viewer, within the
+// operator bounds.
+// A viewer always starts on the newest frame, skipping whatever was
+// published while its last part drained. Zero-copy parts pin a driver
+// buffer until ACKed, so a viewer slower than STREAM_PIN_MS per frame is
+// detached: it streams from a private PSRAM copy and the broker reference
+// is dropped at once, so a weak link can never starve the capture task.
+#define STREAM_MAX_CLIENTS      4
+#define STREAM_FPS_MIN          2       // Operator bounds for per-viewer pacing
+#define STREAM_FPS_MAX          15
+#define STREAM_FPS_GOOD         8       // Raise compression when a viewer cannot reach this
+#define STREAM_QUALITY_BEST     10      // Lowest jpeg_quality value (best image) allowed
+#define STREAM_QUALITY_WORST    30      // Highest jpeg_quality value allowed under pressure
+#define STREAM_QUALITY_STEP     4
+#define STREAM_ADAPT_MS         2000
+#define STREAM_PIN_MS           250     // Slower viewers stream from a private copy
+#define STREAM_PRIVATE_BYTES    (64 * 1024)
+
+struct StreamClient {
+    bool used = false;
+    AsyncClient * tcp = nullptr;
+    float targetFps = STREAM_FPS_MAX;
+    float achievedFps = 0;
+    float deliveryMs = 0;       // EWMA time for one frame to be ACKed in full
+    size_t space = 0;           // Send-buffer space when the last frame started
+    uint32_t frames = 0;
+    uint32_t skipped = 0;       // Frames this viewer never saw
+    uint32_t detached = 0;      // Frames served from the private copy
+    uint32_t frameStart = 0;
+    int64_t frameStartUs = 0;
+    uint8_t * privateBuf = nullptr; // STREAM_PRIVATE_BYTES, kept with the slot once allocated
+};
+
+struct StreamController {
+    StreamClient clients[STREAM_MAX_CLIENTS];
+    int quality = STREAM_QUALITY_BEST;
+    framesize_t ceiling = FRAMESIZE_QVGA;   // Boot frame size: the detector's, never exceeded
+    framesize_t sensorSize = FRAMESIZE_QVGA; // What the sensor is actually set to
+    framesize_t snapshotSize = FRAMESIZE_INVALID;
+    uint32_t snapshotUntil = 0;             // /capture?res= holds the sensor until then
+    int snapshotHolds = 0;                  // ?res= requests still waiting for their frame
+    uint32_t lastAdapt = 0;
+    uint32_t skippedTotal = 0;              // Across all viewers since boot
+    uint32_t detachedTotal = 0;
+    uint32_t heldFrames = 0;                // Off-size frames the detector skipped during holds
+} streamCtl;
+
+portMUX_TYPE streamCtlMux = portMUX_INITIALIZER_UNLOCKED;
+
+void initStreamController(const camera_config_t &config) {
+    streamCtl.quality = config.jpeg_quality;
+    streamCtl.ceiling = config.frame_size;
+    streamCtl.sensorSize = config.frame_size;
+}
+
+int claimStreamClient(AsyncClient * tcp) {
+    int slot = -1;
+    portENTER_CRITICAL(&streamCtlMux);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (!streamCtl.clients[i].used) {
+            uint8_t * buf = streamCtl.clients[i].privateBuf;
+            streamCtl.clients[i] = StreamClient();
+            streamCtl.clients[i].privateBuf = buf;
+            streamCtl.clients[i].used = true;
+            streamCtl.clients[i].tcp = tcp;
+            slot = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&streamCtlMux);
+    return slot;
+}
+
+void releaseStreamClient(int slot) {
+    if (slot < 0) return;
+    portENTER_CRITICAL(&streamCtlMux);
+    streamCtl.clients[slot].used = false;
+    streamCtl.clients[slot].tcp = nullptr;
+    portEXIT_CRITICAL(&streamCtlMux);
+}
+
+// Per-viewer rate ceiling: the operator bound, lowered by the thermal governor.
+float streamFpsCap() {
+    return min((float)STREAM_FPS_MAX, (float)throttle().streamFpsMax);
+}
+
+// A viewer may start a new frame once its pacing interval has elapsed.
+bool streamClientDue(int slot) {
+    StreamClient &c = streamCtl.clients[slot];
+    return c.frames == 0 || millis() - c.frameStart >= 1000 / c.targetFps;
+}
+
+void streamFrameStarted(int slot, uint32_t seqGap) {
+    StreamClient &c = streamCtl.clients[slot];
+    uint32_t now = millis();
+    if (c.frames > 0 && now > c.frameStart) {
+        float fps = 1000.0f / (now - c.frameStart);
+        c.achievedFps = c.achievedFps * 0.8f + fps * 0.2f;
+    }
+    if (c.frames > 0 && seqGap > 1) {
+        c.skipped += seqGap - 1;
+        streamCtl.skippedTotal += seqGap - 1;
+    }
+    c.frames++;
+    c.frameStart = now;
+    c.frameStartUs = esp_timer_get_time();
+    c.space = c.tcp ? c.tcp->space() : 0;
+}
+
+void streamFrameFinished(int slot) {
+    StreamClient &c = streamCtl.clients[slot];
+    recordLatency(LAT_STREAM_FRAME, esp_timer_get_time() - c.frameStartUs);
+    float ms = millis() - c.frameStart;
+    c.deliveryMs = (c.frames == 1) ? ms : c.deliveryMs * 0.7f + ms * 0.3f;
+    // Leave 25% slack so the send buffer can drain between frames
+    float sustainable = 1000.0f / (c.deliveryMs * 1.25f + 1.0f);
+    c.targetFps = constrain(sustainable, (float)STREAM_FPS_MIN, streamFpsCap());
+}
+
+// For a viewer too slow to pin a driver buffer, copy `frame` into its private
+// buffer and return the copy; nullptr keeps the zero-copy path (fast viewer,
+// no PSRAM, or a frame too large to hold).
+const uint8_t * detachStreamFrame(int slot, const BrokerFrame * frame) {
+    StreamClient &c = streamCtl.clients[slot];
+    if (c.deliveryMs <= STREAM_PIN_MS || frame->jpgLen > STREAM_PRIVATE_BYTES) return nullptr;
+    if (!c.privateBuf) {
+        c.privateBuf = (uint8_t *) heap_caps_malloc(STREAM_PRIVATE_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!c.privateBuf) return nullptr;
     }
+    memcpy(c.privateBuf, frame->jpg, frame->jpgLen);
+    c.detached++;
+    streamCtl.detachedTotal++;
+    return c.privateBuf;
+}
+
+// Called from loop(): steer shared JPEG quality toward the slowest viewer.
+void adaptStreamQuality() {
+    if (millis() - streamCtl.lastAdapt < STREAM_ADAPT_MS) return;
+    streamCtl.lastAdapt = millis();
+
+    int viewers = 0;
+    float cap = streamFpsCap();
+    float slowest = cap;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        StreamClient &c = streamCtl.clients[i];
+        if (!c.used || c.frames < 3) continue;
+        viewers++;
+        if (c.targetFps < slowest) slowest = c.targetFps;
+    }
+
+    // Past the quality bound a slow viewer just skips more frames
+    int quality = streamCtl.quality;
+    if (viewers > 0 && slowest < min((float)STREAM_FPS_GOOD, cap)) {
+        quality = min(quality + STREAM_QUALITY_STEP, STREAM_QUALITY_WORST);
+    } else if (viewers == 0 || slowest >= cap) {
+        quality = max(quality - STREAM_QUALITY_STEP, STREAM_QUALITY_BEST);
+    }
+    if (quality == streamCtl.quality) return;
+    sensor_t * s = esp_camera_sensor_get();
+    if (!s) return;
+    s->set_quality(s, quality);
+    streamCtl.quality = quality;
+}
+
+// Called from loop(): the only place the sensor frame size is written.
+void applySensorFrameSize() {
+    bool snapshot = streamCtl.snapshotSize != FRAMESIZE_INVALID && (int32_t)(streamCtl.snapshotUntil - millis()) > 0;
+    framesize_t wanted = snapshot ? streamCtl.snapshotSize : streamCtl.ceiling;
+    if (wanted == streamCtl.sensorSize) return;
+    sensor_t * s = esp_camera_sensor_get();
+    if (!s) return;
+    s->set_framesize(s, wanted);
+    streamCtl.sensorSize = wanted;
 }
 
 // ==========================================================
@@ -129,137 +642,1164 @@ void runThermalCheck() {
 #define BOUNDARY "pyramid_frame"
 static const char* _STREAM_HEADER = "multipart/x-mixed-replace;boundary=" BOUNDARY;
 
-struct StreamState {
-    camera_fb_t * fb = nullptr;
-    size_t offset = 0;
-    bool header_sent = false;
-    ~StreamState() {
-        if (fb) esp_camera_fb_return(fb);
+// Viewers are served zero-copy: each multipart part points lwIP straight at
+// the broker frame's JPEG (no ASYNC_WRITE_FLAG_COPY, ASYNC_WRITE_FLAG_MORE
+// until the part's trailer), and the frame reference is only dropped once
+// the part has been ACKed. Every viewer of a frame shares the one buffer, so
+// adding viewers adds no copies and no internal-RAM send buffers. One part is
+// in flight per viewer; its ACK time is what the stream controller paces on.
+// Detached (slow) viewers send the same way from their private copy instead.
+class StreamResponse : public AsyncWebServerResponse {
+    int _slot;
+    BrokerFrame * _frame = nullptr;  // Pinned while a zero-copy part is in flight
+    const uint8_t * _data = nullptr; // Current part's JPEG, nullptr between parts
+    size_t _len = 0;
+    uint32_t _lastSeq = 0;
+    size_t _queued = 0;         // JPEG bytes of the current part handed to lwIP
+    bool _headerQueued = false;
+    bool _trailerQueued = false;
+    size_t _partEnd = 0;        // _writtenLength once the whole part is queued
+  public:
+    StreamResponse(int slot) : _slot(slot) {
+        _code = 200;
+        _contentType = _STREAM_HEADER;
+        _sendContentLength = false;
+        _chunked = false;       // The stream simply ends when the viewer goes away
+    }
+    ~StreamResponse() {
+        releaseFrame(_frame);
+        releaseStreamClient(_slot);
+    }
+    bool _sourceValid() const override { return true; }
+
+    void _respond(AsyncWebServerRequest *request) override {
+        String head = _assembleHead(request->version());
+        _headLength = head.length();
+        _writtenLength += request->client()->add(head.c_str(), _headLength);
+        _state = RESPONSE_CONTENT;
+        _ack(request, 0, 0);
+    }
+
+    size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time) override {
+        _ackedLength += len;
+        if (_state != RESPONSE_CONTENT) return 0;
+        if (_data && _trailerQueued && _ackedLength >= _partEnd) {
+            streamFrameFinished(_slot);
+            releaseFrame(_frame);
+            _frame = nullptr;
+            _data = nullptr;
+        }
+        if (!_data) {
+            // Nothing due yet: the next ACK or poll comes back here
+            if (!streamClientDue(_slot)) return 0;
+            _frame = acquireFrame(_lastSeq, true);
+            if (!_frame) return 0;
+            streamFrameStarted(_slot, _frame->seq - _lastSeq);
+            _lastSeq = _frame->seq;
+            _len = _frame->jpgLen;
+            _data = detachStreamFrame(_slot, _frame);
+            if (_data) {
+                releaseFrame(_frame);
+                _frame = nullptr;
+            } else {
+                _data = _frame->jpg;
+            }
+            _queued = 0;
+            _headerQueued = false;
+            _trailerQueued = false;
+        }
+
+        int64_t start = esp_timer_get_time();
+        AsyncClient * c = request->client();
+        size_t queued = 0;
+        if (!_headerQueued) {
+            char header[128];
+            int hlen = snprintf(header, sizeof(header), "--" BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", _len);
+            if (c->space() < (size_t)hlen) return 0;
+            queued += c->add(header, hlen, ASYNC_WRITE_FLAG_COPY | ASYNC_WRITE_FLAG_MORE);
+            _headerQueued = true;
+        }
+        size_t remaining = _len - _queued;
+        size_t n = (remaining < c->space()) ? remaining : c->space();
+        if (n) {
+            size_t added = c->add((const char *) _data + _queued, n, ASYNC_WRITE_FLAG_MORE);
+            _queued += added;
+            queued += added;
+        }
+        if (_queued == _len && !_trailerQueued && c->space() >= 2) {
+            queued += c->add("\r\n", 2, 0);    // A literal, so it outlives any connection
+            _trailerQueued = true;
+        }
+        _writtenLength += queued;
+        if (_trailerQueued) _partEnd = _writtenLength;
+        if (queued) c->send();
+        recordLatency(LAT_STREAM_CHUNK, esp_timer_get_time() - start);
+        return queued;
     }
 };
 
 void streamService(AsyncWebServerRequest *request) {
+    int slot = claimStreamClient(request->client());
+    if (slot < 0) {
+        request->send(503, "application/json", "{\"error\":\"too many viewers\"}");
+        return;
+    }
+
     activeStreams++;
     request->onDisconnect([](){
         if(activeStreams > 0) activeStreams--;
     });
-    
-    std::shared_ptr<StreamState> ctx = std::make_shared<StreamState>();
 
+    AsyncWebServerResponse *response = new StreamResponse(slot);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+}
+
+// ==========================================================
+// 📷 SNAPSHOT SERVICE (/capture)
+// ==========================================================
+// The JPEG goes out straight from the broker frame: lwIP is handed
+// pointers into frame->jpg without ASYNC_WRITE_FLAG_COPY, and the broker
+// reference is only dropped once the last byte has been ACKed. A ?res=
+// snapshot holds the sensor at that size and waits for a matching frame
+// before any header is sent, so a timeout is a 504 instead of an empty 200.
+// The detector pauses for the hold: NeuralKernel skips every frame that is
+// not the size its buffers and the motion gate were set up for.
+#define SNAPSHOT_TIMEOUT_MS 2000
+
+// Concurrent ?res= requests share the hold; the sensor goes back to the
+// stream controller when the last one has its frame or gives up.
+void holdSnapshotSensor(framesize_t size, uint32_t until) {
+    streamCtl.snapshotSize = size;
+    if (streamCtl.snapshotHolds++ == 0 || (int32_t)(until - streamCtl.snapshotUntil) > 0) streamCtl.snapshotUntil = until;
+}
+
+void releaseSnapshotSensor() {
+    if (streamCtl.snapshotHolds > 0 && --streamCtl.snapshotHolds == 0) streamCtl.snapshotUntil = millis();
+}
+
+bool detectorSizedFrame(const camera_fb_t * fb) {
+    return fb->width == resolution[streamCtl.ceiling].width && fb->height == resolution[streamCtl.ceiling].height;
+}
+
+class FrameResponse : public AsyncWebServerResponse {
+    BrokerFrame * _frame;
+    size_t _queued = 0;         // JPEG bytes handed to lwIP so far
+    framesize_t _size = FRAMESIZE_INVALID;  // Frame size still being waited for
+    uint32_t _deadline = 0;
+    uint32_t _lastSeq = 0;
+    bool _holding = false;      // Counted in streamCtl.snapshotHolds
+  public:
+    FrameResponse(BrokerFrame * frame) : _frame(frame) {
+        _code = 200;
+        _contentType = "image/jpeg";
+        _contentLength = frame->jpgLen;
+        _sendContentLength = true;
+        _chunked = false;
+    }
+    FrameResponse(framesize_t size) : _frame(nullptr), _size(size), _holding(true) {
+        _code = 200;
+        _contentType = "image/jpeg";
+        _sendContentLength = true;
+        _chunked = false;
+        _deadline = millis() + SNAPSHOT_TIMEOUT_MS;
+        holdSnapshotSensor(size, _deadline);
+    }
+    ~FrameResponse() {
+        releaseFrame(_frame);
+        if (_holding) releaseSnapshotSensor();
+    }
+    bool _sourceValid() const override { return _frame != nullptr || _size != FRAMESIZE_INVALID; }
+
+    void _respond(AsyncWebServerRequest *request) override {
+        _state = RESPONSE_HEADERS;
+        _ack(request, 0, 0);
+    }
+
+    bool _awaitFrame() {
+        BrokerFrame * frame = acquireFrame(_lastSeq, true);
+        if (!frame) return false;
+        _lastSeq = frame->seq;
+        if (frame->fb->width != resolution[_size].width || frame->fb->height != resolution[_size].height) {
+            releaseFrame(frame);
+            return false;
+        }
+        _frame = frame;
+        _holding = false;
+        releaseSnapshotSensor();
+        return true;
+    }
+
+    size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time) override {
+        _ackedLength += len;
+        size_t queued = 0;
+        AsyncClient * c = request->client();
+        if (_state == RESPONSE_HEADERS) {
+            if (!_frame && !_awaitFrame()) {
+                // Nothing yet: the next poll comes back here until the deadline
+                if ((int32_t)(millis() - _deadline) <= 0) return 0;
+                static const char body[] = "{\"error\":\"no frame\"}";
+                _code = 504;
+                _contentType = "application/json";
+                _contentLength = sizeof(body) - 1;
+                String head = _assembleHead(request->version());
+                _headLength = head.length();
+                queued = c->add(head.c_str(), _headLength);
+                queued += c->add(body, _contentLength, 0);
+                _writtenLength += queued;
+                c->send();
+                _state = RESPONSE_WAIT_ACK;
+                return queued;
+            }
+            _contentLength = _frame->jpgLen;
+            String head = _assembleHead(request->version());
+            _headLength = head.length();
+            _writtenLength += c->add(head.c_str(), _headLength);
+            _state = RESPONSE_CONTENT;
+        }
+        if (_state == RESPONSE_CONTENT) {
+            size_t remaining = _frame->jpgLen - _queued;
+            size_t n = (remaining < c->space()) ? remaining : c->space();
+            if (n) {
+                uint8_t flags = (n < remaining) ? ASYNC_WRITE_FLAG_MORE : 0;
+                queued = c->add((const char *) _frame->jpg + _queued, n, flags);
+                _queued += queued;
+                _writtenLength += queued;
+            }
+            c->send();
+            if (_queued == _frame->jpgLen) _state = RESPONSE_WAIT_ACK;
+        }
+        if (_state == RESPONSE_WAIT_ACK && _ackedLength >= _writtenLength) _state = RESPONSE_END;
+        return queued;
+    }
+};
+
+framesize_t parseFrameSize(const String &res) {
+    static const struct { const char * name; framesize_t size; } sizes[] = {
+        {"qqvga", FRAMESIZE_QQVGA}, {"hqvga", FRAMESIZE_HQVGA}, {"qvga", FRAMESIZE_QVGA},
+        {"cif", FRAMESIZE_CIF}, {"vga", FRAMESIZE_VGA}, {"svga", FRAMESIZE_SVGA},
+    };
+    for (auto &s : sizes) {
+        if (res.equalsIgnoreCase(s.name)) return s.size;
+    }
+    return FRAMESIZE_INVALID;
+}
+
+void captureService(AsyncWebServerRequest *request) {
+    framesize_t size = streamCtl.sensorSize;
+    if (request->hasParam("res")) {
+        size = parseFrameSize(request->getParam("res")->value());
+        if (size == FRAMESIZE_INVALID || size > streamCtl.ceiling) {
+            request->send(400, "application/json", "{\"error\":\"unsupported res\"}");
+            return;
+        }
+    }
+
+    if (size == streamCtl.sensorSize) {
+        BrokerFrame * frame = acquireFrame(0, true);
+        if (frame) {
+            request->send(new FrameResponse(frame));
+            return;
+        }
+        if (!broker.rawCapture) {
+            request->send(503, "application/json", "{\"status\":\"failed\"}");
+            return;
+        }
+        // Raw capture with nobody watching: the hold below makes the capture task encode
+    }
+
+    // Another size (or no JPEG yet): hold the sensor until a matching JPEG comes through
+    request->send(new FrameResponse(size));
+}
+
+// ==========================================================
+// 🎞️ PRE-EVENT RING & ALERT CLIPS
+// ==========================================================
+// The capture task copies raw JPEG frames (no re-encode) into a fixed-slot
+// PSRAM ring at CLIP_FPS. An alert starts a post-roll; once it has elapsed
+// the frames around the trigger are pinned as the clip served on /clip,
+// while the remaining unpinned slots keep recording the next pre-roll.
+#define CLIP_FPS            4       // Frames per second kept in the ring
+#define CLIP_PREROLL_S      5       // Seconds before the trigger kept in a clip
+#define CLIP_POSTROLL_S     3       // Seconds after the trigger kept in a clip
+// A clip pins (PRE + POST) * FPS = 32 slots; the rest keep recording so a
+// follow-up alert still gets pre-roll while a clip is being served.
+#if ROI_DETECTION
+// VGA JPEGs run 30-45 KB, so slots double and the spare pre-roll drops to
+// 2 s. The 1.9 MB ring fits because ROI mode holds no RGB888 frame (the
+// crops share 230 KB): with three ~60 KB frame buffers it stays under
+// 2.5 MB of the 4 MB PSRAM.
+#define CLIP_RING_SLOTS     40
+#define CLIP_SLOT_BYTES     (48 * 1024)
+#else
+#define CLIP_RING_SLOTS     48
+#define CLIP_SLOT_BYTES     (24 * 1024)
+#endif
+
+enum ClipState { CLIP_NONE, CLIP_POSTROLL, CLIP_READY };
+
+struct ClipSlot {
+    uint8_t * buf = nullptr;
+    size_t len = 0;             // 0 = empty or being written
+    uint32_t ts = 0;
+    bool pinned = false;
+};
+
+struct ClipRecorder {
+    ClipSlot slots[CLIP_RING_SLOTS];
+    int head = 0;
+    uint32_t lastRecord = 0;
+    ClipState state = CLIP_NONE;
+    uint32_t clipId = 0;
+    uint32_t triggerTime = 0;
+    int frames[CLIP_RING_SLOTS];    // Slot indices of the frozen clip, oldest first
+    int frameCount = 0;
+    int readers = 0;
+    uint32_t oversize = 0;      // Frames too large for a slot
+    uint32_t busy = 0;          // Alerts that found the previous clip still being served
+} clip;
+
+SemaphoreHandle_t clipMutex;
+
+void initClipRecorder() {
+    clipMutex = xSemaphoreCreateMutex();
+    uint8_t * arena = (uint8_t *) heap_caps_malloc((size_t)CLIP_RING_SLOTS * CLIP_SLOT_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!arena) return;     // No PSRAM: recorder stays disabled
+    for (int i = 0; i < CLIP_RING_SLOTS; i++) clip.slots[i].buf = arena + (size_t)i * CLIP_SLOT_BYTES;
+}
+
+// Caller holds clipMutex.
+void freezeClip() {
+    clip.frameCount = 0;
+    for (int i = 0; i < CLIP_RING_SLOTS; i++) {
+        ClipSlot &slot = clip.slots[i];
+        int32_t offset = (int32_t)(slot.ts - clip.triggerTime);
+        if (slot.len == 0 || offset < -CLIP_PREROLL_S * 1000 || offset > CLIP_POSTROLL_S * 1000) continue;
+        int n = clip.frameCount++;
+        while (n > 0 && (int32_t)(clip.slots[clip.frames[n - 1]].ts - slot.ts) > 0) {
+            clip.frames[n] = clip.frames[n - 1];
+            n--;
+        }
+        clip.frames[n] = i;
+        slot.pinned = true;
+    }
+    clip.state = CLIP_READY;
+}
+
+bool clipFrameDue() {
+    return clip.slots[0].buf && millis() - clip.lastRecord >= 1000 / CLIP_FPS;
+}
+
+void recordClipFrame(BrokerFrame * frame) {
+    if (!frame->jpg || !clipFrameDue()) return;
+    uint32_t now = millis();
+    clip.lastRecord = now;
+    if (frame->jpgLen > CLIP_SLOT_BYTES) { clip.oversize++; return; }
+
+    int idx = -1;
+    xSemaphoreTake(clipMutex, portMAX_DELAY);
+    for (int n = 0; n < CLIP_RING_SLOTS; n++) {
+        int i = (clip.head + n) % CLIP_RING_SLOTS;
+        if (!clip.slots[i].pinned) { idx = i; break; }
+    }
+    if (idx >= 0) {
+        clip.slots[idx].len = 0;
+        clip.head = (idx + 1) % CLIP_RING_SLOTS;
+    }
+    xSemaphoreGive(clipMutex);
+    if (idx < 0) return;
+
+    memcpy(clip.slots[idx].buf, frame->jpg, frame->jpgLen);
+
+    xSemaphoreTake(clipMutex, portMAX_DELAY);
+    clip.slots[idx].len = frame->jpgLen;
+    clip.slots[idx].ts = now;
+    if (clip.state == CLIP_POSTROLL && now - clip.triggerTime >= CLIP_POSTROLL_S * 1000) freezeClip();
+    xSemaphoreGive(clipMutex);
+}
+
+// Start a clip for an alert; returns its id, or 0 when no clip will be made.
+uint32_t triggerClip() {
+    if (!clip.slots[0].buf) return 0;
+    uint32_t id = 0;
+    xSemaphoreTake(clipMutex, portMAX_DELAY);
+    if (clip.state == CLIP_POSTROLL) {
+        id = clip.clipId;       // Still recording post-roll: share the clip
+    } else if (clip.readers > 0) {
+        clip.busy++;
+    } else {
+        for (int i = 0; i < clip.frameCount; i++) clip.slots[clip.frames[i]].pinned = false;
+        clip.frameCount = 0;
+        clip.state = CLIP_POSTROLL;
+        clip.triggerTime = millis();
+        id = ++clip.clipId;
+    }
+    xSemaphoreGive(clipMutex);
+    return id;
+}
+
+struct ClipPlayback {
+    const uint8_t * bufs[CLIP_RING_SLOTS];  // Frozen frame list, copied under clipMutex
+    size_t lens[CLIP_RING_SLOTS];
+    int frameCount = 0;
+    int frame = 0;
+    size_t offset = 0;
+    bool header_sent = false;
+    bool reading = false;       // Holds a clip.readers reference
+    uint32_t nextDue = 0;
+    ~ClipPlayback() {
+        if (!reading) return;
+        xSemaphoreTake(clipMutex, portMAX_DELAY);
+        clip.readers--;
+        xSemaphoreGive(clipMutex);
+    }
+};
+
+void clipService(AsyncWebServerRequest *request) {
+    uint32_t wanted = request->hasParam("id") ? request->getParam("id")->value().toInt() : 0;
+    std::shared_ptr<ClipPlayback> ctx = std::make_shared<ClipPlayback>();
+    xSemaphoreTake(clipMutex, portMAX_DELAY);
+    if (clip.state == CLIP_READY && clip.frameCount > 0 && (wanted == 0 || wanted == clip.clipId)) {
+        clip.readers++;
+        ctx->reading = true;
+        ctx->frameCount = clip.frameCount;
+        for (int i = 0; i < clip.frameCount; i++) {
+            ctx->bufs[i] = clip.slots[clip.frames[i]].buf;
+            ctx->lens[i] = clip.slots[clip.frames[i]].len;
+        }
+    }
+    xSemaphoreGive(clipMutex);
+    if (!ctx->reading) {
+        request->send(404, "application/json", "{\"error\":\"clip not available\"}");
+        return;
+    }
+
+    // The frame list is a private copy, and its slots stay pinned while readers > 0
     AsyncWebServerResponse *response = request->beginChunkedResponse(_STREAM_HEADER, [ctx](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        if (ctx->frame >= ctx->frameCount) return 0;
+        if (!ctx->header_sent && millis() < ctx->nextDue) return RESPONSE_TRY_AGAIN;
+        const uint8_t * buf = ctx->bufs[ctx->frame];
+        size_t len = ctx->lens[ctx->frame];
         size_t written = 0;
-        if (!ctx->fb) {
-             ctx->fb = esp_camera_fb_get();
-             if (!ctx->fb) return 0; 
-             ctx->offset = 0;
-             ctx->header_sent = false;
-        }
-
-        while (written < maxLen && ctx->fb) {
-            if (!ctx->header_sent) {
-                 char header[128];
-                 int hlen = snprintf(header, sizeof(header), "--" BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", ctx->fb->len);
-                 if (maxLen - written >= hlen) {
-                     memcpy(buffer + written, header, hlen);
-                     written += hlen;
-                     ctx->header_sent = true;
-                 } else break; 
-            } else {
-                size_t remaining = ctx->fb->len - ctx->offset;
-                size_t space = maxLen - written;
-                if (remaining == 0) {
-                     if (space >= 2) {
-                         memcpy(buffer + written, "\r\n", 2);
-                         written += 2;
-                         esp_camera_fb_return(ctx->fb);
-                         ctx->fb = nullptr;
-                         break; 
-                     } else break;
-                }
-                size_t to_copy = (remaining < space) ? remaining : space;
-                memcpy(buffer + written, ctx->fb->buf + ctx->offset, to_copy);
-                written += to_copy;
-                ctx->offset += to_copy;
-            }
+        if (!ctx->header_sent) {
+            char header[128];
+            int hlen = snprintf(header, sizeof(header), "--" BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", len);
+            if (maxLen < hlen) return RESPONSE_TRY_AGAIN;
+            memcpy(buffer, header, hlen);
+            written = hlen;
+            ctx->header_sent = true;
+            ctx->offset = 0;
+        }
+        size_t remaining = len - ctx->offset;
+        size_t to_copy = (remaining < maxLen - written) ? remaining : maxLen - written;
+        memcpy(buffer + written, buf + ctx->offset, to_copy);
+        written += to_copy;
+        ctx->offset += to_copy;
+        if (ctx->offset == len && maxLen - written >= 2) {
+            memcpy(buffer + written, "\r\n", 2);
+            written += 2;
+            ctx->frame++;
+            ctx->header_sent = false;
+            ctx->nextDue = millis() + 1000 / CLIP_FPS;
         }
         return written;
     });
-    
+
     response->addHeader("Access-Control-Allow-Origin", "*");
     request->send(response);
 }
 
+// ==========================================================
+// 🖼️ DUAL-FORMAT CAPTURE (RAW FOR AI, JPEG ON DEMAND)
+// ==========================================================
+// With PROFILE.rawCapture the sensor delivers RGB565, so the detector only
+// widens pixels instead of decoding a JPEG. A frame is JPEG-encoded into its
+// broker slot only when a viewer is due, a snapshot is waiting or the clip
+// ring wants its next frame; with nobody watching most frames never are.
+// esp32-camera sizes its buffers for one pixel format at init, so the sensor
+// is not switched between formats at runtime.
+#define JPEG_SLOT_BYTES     (32 * 1024)
+
+struct JpegEncoder {
+    uint32_t frames = 0;
+    uint32_t failures = 0;      // Encoder errors or JPEGs larger than JPEG_SLOT_BYTES
+    uint32_t lastUs = 0;
+} jpegEnc;
+
+struct JpegSink {
+    uint8_t * buf;
+    size_t len;
+    bool overflow;
+};
+
+size_t jpegSinkWrite(void * arg, size_t index, const void * data, size_t len) {
+    JpegSink * sink = (JpegSink *) arg;
+    if (!data || !len) return 0;
+    if (sink->len + len > JPEG_SLOT_BYTES) {
+        sink->overflow = true;
+        return len;
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    return len;
+}
+
+void initJpegEncoder() {
+    uint8_t * arena = (uint8_t *) heap_caps_malloc((size_t)BROKER_SLOTS * JPEG_SLOT_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!arena) return;     // Raw frames then never carry a JPEG
+    for (int i = 0; i < BROKER_SLOTS; i++) broker.slots[i].encodeBuf = arena + (size_t)i * JPEG_SLOT_BYTES;
+}
+
+bool jpegWanted() {
+    if ((int32_t)(streamCtl.snapshotUntil - millis()) > 0) return true;
+    if (PROFILE.clips && clipFrameDue()) return true;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (streamCtl.clients[i].used && streamClientDue(i)) return true;
+    }
+    return false;
+}
+
+void encodeFrameJpeg(BrokerFrame * frame) {
+    if (!frame->encodeBuf) return;
+    camera_fb_t * fb = frame->fb;
+    // Sensor scale runs 0-63 with lower being better; the encoder wants 1-100, higher better
+    uint8_t quality = constrain(100 - streamCtl.quality * 2, 10, 90);
+    JpegSink sink = {frame->encodeBuf, 0, false};
+    int64_t start = esp_timer_get_time();
+    bool ok = fmt2jpg_cb(fb->buf, fb->len, fb->width, fb->height, fb->format, quality, jpegSinkWrite, &sink);
+    jpegEnc.lastUs = esp_timer_get_time() - start;
+    recordLatency(LAT_ENCODE, jpegEnc.lastUs);
+    if (!ok || sink.overflow) {
+        jpegEnc.failures++;
+        return;
+    }
+    frame->jpg = frame->encodeBuf;
+    frame->jpgLen = sink.len;
+    jpegEnc.frames++;
+}
+
+// Single producer for the broker; also feeds the pre-event ring.
+void CaptureTask(void * p) {
+    while(true) {
+        // With a single driver buffer the next grab would wait on our own reference
+        if (!broker.holdLatest) {
+            vTaskDelay(40 / portTICK_PERIOD_MS);
+            retireLatest();
+        }
+        int64_t sensorStart = esp_timer_get_time();
+        camera_fb_t * fb = esp_camera_fb_get();
+        if (!fb) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+        recordLatency(LAT_SENSOR, esp_timer_get_time() - sensorStart);
+        BrokerFrame * frame = claimSlot(fb);
+        if (!frame) continue;
+        if (broker.rawCapture && jpegWanted()) encodeFrameJpeg(frame);
+        if constexpr (PROFILE.clips) recordClipFrame(frame);
+        publishFrame(frame);
+    }
+}
+
+// ==========================================================
+// ⚡ BURST ANALYSIS (HUB-TRIGGERED)
+// ==========================================================
+// When a hub's PIR or ultrasonic trips it sends a WIRE_BURST command over
+// ESP-NOW and the WebSocket (the second copy is dropped by burstId). A
+// camera named in the mask wakes the kernel out of its frame sleep at once,
+// runs detection on every frame regardless of the motion gate and holds
+// DETECT_FPS_BURST until the burst runs out. The first burst inference is
+// acknowledged with its receive-to-inference time. The burst window itself
+// lives in neural_pipeline.h so replay can run bursts too.
+#define DETECT_FPS_BURST    12
+
+// Hub frames arrive on the ESP-NOW callback and in WebSocket loop(); both only flag the kernel.
+void handleHubCommand(const uint8_t * data, int len) {
+    WireHeader hdr;
+    WireRecord records[4];
+    int count = 0;
+    if (wireDecode(data, len, hdr, records, 4, count) != WIRE_OK || hdr.camId != WIRE_HUB_ID) return;
+    for (int i = 0; i < count; i++) {
+        WireBurst cmd;
+        if (records[i].type != WIRE_BURST || !wireRead(records[i], cmd)) continue;
+        if (!(cmd.cameraMask & (1 << CAM_ID))) continue;
+        if (startBurst(cmd.burstId, cmd.durationMs) && AI_Task_Handle) xTaskNotifyGive(AI_Task_Handle);
+    }
+}
+
+void onHubEspNow(const uint8_t * mac, const uint8_t * data, int len) {
+    handleHubCommand(data, len);
+}
+
+// ==========================================================
+// ⏱️ FRAME BUDGET SCHEDULER
+// ==========================================================
+// Every detection frame is timed (capture wait, gate, decode, detect) and
+// the kernel sleeps only for what is left of the frame period, so the
+// detection rate is set by DETECT_FPS_* (scaled by the thermal governor,
+// never below DETECT_FPS_FLOOR) rather than by fixed delays. The sleep is a
+// task-notify wait, so a hub burst command cuts it short. While
+// viewers are connected detection may use at most DETECT_CPU_SHARE of the
+// core, leaving the rest for the stream path (paced up to STREAM_FPS_MAX).
+#define DETECT_FPS_IDLE         3       // Target detection rate, nothing in view
+#define DETECT_FPS_ALERT        8       // Target detection rate while verifying a target
+#define DETECT_FPS_FLOOR        1       // However hard the governor throttles
+#define DETECT_CPU_SHARE        0.6f    // Detection share of the core while streaming
+
+struct FrameScheduler {
+    float workUs = 0;           // EWMA of a whole frame's work
+    float targetFps = DETECT_FPS_IDLE;
+    float achievedFps = 0;
+    int64_t lastFrameStart = 0;
+    uint32_t deadlines = 0;
+    uint32_t missed = 0;        // Frames whose work overran the target period
+} sched;
+
+// Account for a finished frame and return how long to sleep before the next one.
+uint32_t scheduleNextFrame(int64_t frameStart) {
+    int64_t workUs = esp_timer_get_time() - frameStart;
+    recordLatency(LAT_FRAME, workUs);
+    if (sched.lastFrameStart) {
+        float fps = 1000000.0f / (frameStart - sched.lastFrameStart);
+        sched.achievedFps = sched.achievedFps * 0.8f + fps * 0.2f;
+    }
+    sched.lastFrameStart = frameStart;
+
+    float target = burstActive() ? DETECT_FPS_BURST : (currentState == ANALYZING) ? DETECT_FPS_ALERT : DETECT_FPS_IDLE;
+    target = max((float)DETECT_FPS_FLOOR, target * throttle().detectScale);
+    sched.targetFps = target;
+
+    float periodUs = 1000000.0f / target;
+    sched.workUs = sched.workUs * 0.8f + workUs * 0.2f;
+    sched.deadlines++;
+    if (workUs > periodUs) sched.missed++;
+
+    // Stretch the period so detection stays inside its share while anyone is watching
+    if (activeStreams > 0 && sched.workUs / DETECT_CPU_SHARE > periodUs) periodUs = sched.workUs / DETECT_CPU_SHARE;
+
+    int64_t sleepUs = (int64_t)periodUs - workUs;
+    return sleepUs > 1000 ? sleepUs / 1000 : 1;     // Always yield at least one tick
+}
+
+// ==========================================================
+// 📨 UPLINK DIGEST & TELEMETRY
+// ==========================================================
+// Alerts, track updates, clip ids and health counters are batched into one
+// binary sentinel_wire.h frame on the WebSocket every WS_DIGEST_MS; the
+// first alert of a new track flushes it at once. WebSocketsClient is only
+// safe from the task running webSocket.loop(), so the kernel hands finished
+// frames to loop() through a small outbox and never sends itself.
+#define WS_DIGEST_MS        500
+#define TELEMETRY_MS        1000    // Heartbeat + stats cadence
+#define WS_OUTBOX_SLOTS     4       // Finished digests waiting for loop()
+
+WireWriter wsDigest;            // Only touched by the neural kernel task
+uint32_t wsDigestLastFlush = 0;
+uint32_t wsDigestsSent = 0;
+
+struct WsOutbox {
+    uint8_t buf[WS_OUTBOX_SLOTS][WIRE_FRAME_MAX];
+    size_t len[WS_OUTBOX_SLOTS];
+    uint32_t head = 0;          // Written by the kernel
+    uint32_t tail = 0;          // Written by loop()
+    uint32_t drops = 0;         // Digests lost to a full outbox
+} wsOutbox;
+
+portMUX_TYPE wsOutboxMux = portMUX_INITIALIZER_UNLOCKED;
+
+void flushDigest() {
+    wsDigestLastFlush = millis();
+    if (!wsDigest.records) return;
+    size_t len = wireFinish(wsDigest, CAM_ID, millis());
+    portENTER_CRITICAL(&wsOutboxMux);
+    if (wsOutbox.head - wsOutbox.tail < WS_OUTBOX_SLOTS) {
+        uint32_t slot = wsOutbox.head % WS_OUTBOX_SLOTS;
+        memcpy(wsOutbox.buf[slot], wsDigest.buf, len);
+        wsOutbox.len[slot] = len;
+        wsOutbox.head++;
+    } else {
+        wsOutbox.drops++;
+    }
+    portEXIT_CRITICAL(&wsOutboxMux);
+    wireBegin(wsDigest);
+}
+
+// loop() only, next to webSocket.loop().
+void sendQueuedDigests() {
+    static uint8_t frame[WIRE_FRAME_MAX];
+    while (true) {
+        size_t len = 0;
+        portENTER_CRITICAL(&wsOutboxMux);
+        if (wsOutbox.tail != wsOutbox.head) {
+            uint32_t slot = wsOutbox.tail % WS_OUTBOX_SLOTS;
+            len = wsOutbox.len[slot];
+            memcpy(frame, wsOutbox.buf[slot], len);
+            wsOutbox.tail++;
+        }
+        portEXIT_CRITICAL(&wsOutboxMux);
+        if (!len) return;
+        int64_t start = esp_timer_get_time();
+        webSocket.sendBIN(frame, len);
+        recordLatency(LAT_SEND, esp_timer_get_time() - start);
+        wsDigestsSent++;
+    }
+}
+
+void queueDigest(uint8_t type, const void * payload, size_t len) {
+    if (wireAppend(wsDigest, type, payload, len)) return;
+    flushDigest();
+    wireAppend(wsDigest, type, payload, len);
+}
+
+WireBox toWireBox(const Detection &d) {
+    WireBox b;
+    b.x1 = max(0, d.x1);
+    b.y1 = max(0, d.y1);
+    b.x2 = max(0, d.x2);
+    b.y2 = max(0, d.y2);
+    b.score = constrain(d.score, 0.0f, 1.0f) * 255;
+    return b;
+}
+
+// A track's box first, then the other detections of this frame.
+WireAlert buildAlert(const Track * t, const DetectionResult &detections) {
+    WireAlert alert;
+    alert.trackId = t->id;
+    alert.ageMs = millis() - t->firstSeen;
+    alert.tempCenti = health.temperature * 100;
+    alert.boxCount = 0;
+    alert.boxes[alert.boxCount++] = toWireBox(t->box);
+    for (int i = 0; i < detections.count && alert.boxCount < WIRE_MAX_BOXES; i++) {
+        if (boxIoU(detections.boxes[i], t->box) > TRACK_MATCH_IOU) continue;
+        alert.boxes[alert.boxCount++] = toWireBox(detections.boxes[i]);
+    }
+    return alert;
+}
+
+// Report the first inference of a burst on every uplink, at once.
+void ackBurst(uint8_t detections) {
+    portENTER_CRITICAL(&burstMux);
+    WireBurstAck ack = {burst.id, (uint32_t)(esp_timer_get_time() - burst.rxUs), detections};
+    burst.pendingAck = false;
+    portEXIT_CRITICAL(&burstMux);
+    recordLatency(LAT_BURST, ack.rxToInferUs);
+    queueDigest(WIRE_BURST_ACK, &ack, sizeof(ack));
+    flushDigest();
+    if constexpr (PROFILE.espNow) {
+        queueEspNow(WIRE_BURST_ACK, &ack, sizeof(ack));
+        flushEspNow();
+    }
+}
+
+void queueTelemetry() {
+    int64_t start = esp_timer_get_time();
+    WireHeartbeat hb;
+    hb.tempCenti = health.temperature * 100;
+    hb.freeHeap = health.freeHeap;
+    hb.minFreeHeap = health.minFreeHeap;
+    hb.state = currentState;
+    hb.uptimeS = millis() / 1000;
+    hb.throttle = thermal.level;
+    hb.headroomCenti = thermalHeadroom() * 100;
+    hb.coveragePct = throttle().detectScale * 100;
+
+    WireStats st;
+    st.framesProcessed = health.framesProcessed;
+    st.alertsSent = health.alertsSent;
+    st.gateHits = motionGate.hits;
+    st.gateMisses = motionGate.misses;
+    st.detectUs = stageTimes.detectUs;
+    st.detectFpsX10 = sched.achievedFps * 10;
+    st.tracks = confirmedTracks();
+    recordLatency(LAT_SERIALIZE, esp_timer_get_time() - start);
+
+    queueDigest(WIRE_HEARTBEAT, &hb, sizeof(hb));
+    queueDigest(WIRE_STATS, &st, sizeof(st));
+
+    if constexpr (PROFILE.espNow) {
+        queueEspNow(WIRE_HEARTBEAT, &hb, sizeof(hb));
+        queueEspNow(WIRE_STATS, &st, sizeof(st));
+        flushEspNow();
+    }
+}
+
+// ==========================================================
+// 👤 KNOWN-FACE SUPPRESSION
+// ==========================================================
+// A track is identified once, on the pass it is confirmed: the face is
+// aligned from its landmarks, embedded and matched against the enrolled
+// table, and only strangers go on to alert. Embeddings are stored unit
+// length in one contiguous PSRAM array, so the nearest neighbour is a
+// straight scan of dot products (cosine similarity). Table writes happen
+// in the kernel only; the HTTP handlers just post requests. The table is
+// RAM-resident, so people are re-enrolled after a reboot.
+#define FACE_MAX_ENROLLED   32
+#define FACE_MATCH_COSINE   0.55f   // esp-face's own recognition threshold
+#define FACE_ID_TRIES       3       // Passes to wait for an alignable face before alerting anyway
+#define FACE_ENROLL_MS      15000   // An enrolment request waits this long for a lone face
+#define FACE_NAME_LEN       16
+
+struct FaceTable {
+    float * embeddings = nullptr;       // FACE_MAX_ENROLLED x FACE_ID_SIZE, unit length
+    char names[FACE_MAX_ENROLLED][FACE_NAME_LEN];
+    int count = 0;
+    dl_matrix3du_t * aligned = nullptr; // FACE_WIDTH x FACE_HEIGHT input to get_face_id()
+    bool enabled = false;
+    // Requests from the HTTP handlers, applied by the kernel. These, count and
+    // names change under faceMux; the kernel alone touches the embeddings.
+    volatile bool enrollPending = false;
+    char enrollName[FACE_NAME_LEN];
+    uint32_t enrollSince = 0;
+    volatile int removePending = -1;    // Table index, or FACE_MAX_ENROLLED for all
+    uint32_t checks = 0;                // Tracks run through recognition
+    uint32_t known = 0;                 // Tracks matched to an enrolled person
+    uint32_t alignFailures = 0;
+} faces;
+
+portMUX_TYPE faceMux = portMUX_INITIALIZER_UNLOCKED;
+
+void initFaceTable() {
+    faces.embeddings = (float *) heap_caps_malloc(FACE_MAX_ENROLLED * FACE_ID_SIZE * sizeof(float), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    faces.aligned = dl_matrix3du_alloc(1, FACE_WIDTH, FACE_HEIGHT, 3);
+    faces.enabled = faces.embeddings && faces.aligned;
+}
+
+// Align and embed one detection into `out` (unit length). False if the face could not be aligned.
+bool embedFace(dl_matrix3du_t * frame, const Detection &detection, float * out) {
+    Detection d;
+    dl_matrix3du_t * image = detectionImage(frame, detection, d);
+    if (!image) return false;
+    box_t box;
+    box.box_p[0] = d.x1; box.box_p[1] = d.y1;
+    box.box_p[2] = d.x2; box.box_p[3] = d.y2;
+    landmark_t mark;
+    memcpy(mark.landmark_p, d.landmarks, sizeof(mark.landmark_p));
+    fptp_t score = d.score;
+    box_array_t one;
+    one.box = &box;
+    one.score = &score;
+    one.landmark = &mark;
+    one.len = 1;
+    if (align_face(&one, image, faces.aligned) != ESP_OK) return false;
+    dl_matrix3d_t * id = get_face_id(faces.aligned);
+    if (!id) return false;
+    float norm = 0;
+    for (int i = 0; i < FACE_ID_SIZE; i++) norm += id->item[i] * id->item[i];
+    norm = sqrtf(norm);
+    for (int i = 0; i < FACE_ID_SIZE; i++) out[i] = norm > 0 ? id->item[i] / norm : 0;
+    dl_matrix3d_free(id);
+    return norm > 0;
+}
+
+// Closest enrolled face to a unit-length probe, or -1 if the table is empty.
+int nearestFace(const float * probe, float * similarity) {
+    int best = -1;
+    float bestDot = -2.0f;
+    for (int i = 0; i < faces.count; i++) {
+        const float * e = faces.embeddings + i * FACE_ID_SIZE;
+        float dot = 0;
+        for (int k = 0; k < FACE_ID_SIZE; k++) dot += e[k] * probe[k];
+        if (dot > bestDot) { bestDot = dot; best = i; }
+    }
+    *similarity = bestDot;
+    return best;
+}
+
+void applyFaceRequests(dl_matrix3du_t * image, const DetectionResult &detections, float * probe) {
+    int remove = faces.removePending;
+    if (remove >= 0) {
+        int last = -1;
+        portENTER_CRITICAL(&faceMux);
+        if (remove >= FACE_MAX_ENROLLED) faces.count = 0;
+        else if (remove < faces.count) {
+            // Keep the table dense: the last entry takes the freed row
+            last = --faces.count;
+            memcpy(faces.names[remove], faces.names[last], FACE_NAME_LEN);
+        }
+        faces.removePending = -1;
+        portEXIT_CRITICAL(&faceMux);
+        if (last >= 0) memcpy(faces.embeddings + remove * FACE_ID_SIZE, faces.embeddings + last * FACE_ID_SIZE, FACE_ID_SIZE * sizeof(float));
+    }
+    if (!faces.enrollPending) return;
+    uint32_t now = millis();
+    bool expired = false;
+    portENTER_CRITICAL(&faceMux);
+    if (now - faces.enrollSince > FACE_ENROLL_MS) {
+        faces.enrollPending = false;
+        expired = true;
+    }
+    portEXIT_CRITICAL(&faceMux);
+    if (expired) {
+        Serial.printf("[%s] -> ENROLMENT TIMED OUT.\n", SECTOR);
+        return;
+    }
+    // Only an unambiguous scene enrols: exactly one face in view
+    if (detections.count != 1 || faces.count >= FACE_MAX_ENROLLED) return;
+    if (!embedFace(image, detections.boxes[0], probe)) return;
+    memcpy(faces.embeddings + faces.count * FACE_ID_SIZE, probe, FACE_ID_SIZE * sizeof(float));
+    portENTER_CRITICAL(&faceMux);
+    memcpy(faces.names[faces.count], faces.enrollName, FACE_NAME_LEN);
+    faces.count++;
+    faces.enrollPending = false;
+    portEXIT_CRITICAL(&faceMux);
+    Serial.printf("[%s] -> ENROLLED %s (%d/%d).\n", SECTOR, faces.names[faces.count - 1], faces.count, FACE_MAX_ENROLLED);
+}
+
+// Settle the identity of every newly confirmed track before reports go out.
+void identifyTracks(dl_matrix3du_t * image, const DetectionResult &detections) {
+    static float probe[FACE_ID_SIZE];   // Kernel only
+    applyFaceRequests(image, detections, probe);
+    for (int i = 0; i < TRACK_SLOTS; i++) {
+        Track &t = tracker.tracks[i];
+        if (!t.used || t.hits < TRACK_CONFIRM_HITS) continue;
+        if (t.identity != ID_UNCHECKED && t.identity != ID_CHECKING) continue;
+        if (!faces.count) { t.identity = ID_STRANGER; continue; }
+        if (t.match < 0) continue;
+        int64_t start = esp_timer_get_time();
+        bool embedded = embedFace(image, detections.boxes[t.match], probe);
+        float similarity = 0;
+        int who = embedded ? nearestFace(probe, &similarity) : -1;
+        recordLatency(LAT_RECOGNIZE, esp_timer_get_time() - start);
+        if (!embedded) {
+            faces.alignFailures++;
+            t.identity = (++t.idTries >= FACE_ID_TRIES) ? ID_STRANGER : ID_CHECKING;
+            continue;
+        }
+        faces.checks++;
+        if (who >= 0 && similarity >= FACE_MATCH_COSINE) {
+            t.identity = ID_KNOWN;
+            faces.known++;
+            Serial.printf("[%s] -> TRACK %u IS %s (%.2f). SUPPRESSED.\n", SECTOR, t.id, faces.names[who], similarity);
+        } else {
+            t.identity = ID_STRANGER;
+        }
+    }
+}
+
+// POST /faces?name= enrols the next lone face; GET lists; DELETE ?name= (or everyone) removes.
+void facesService(AsyncWebServerRequest *request) {
+    if (!faces.enabled) {
+        request->send(503, "application/json", "{\"error\":\"recognition unavailable\"}");
+        return;
+    }
+    String name = request->hasParam("name") ? request->getParam("name")->value() : String();
+    // The kernel edits the table while we run; work from a consistent copy
+    char names[FACE_MAX_ENROLLED][FACE_NAME_LEN];
+    portENTER_CRITICAL(&faceMux);
+    int count = faces.count;
+    memcpy(names, faces.names, sizeof(names));
+    bool enrolling = faces.enrollPending;
+    bool removing = faces.removePending >= 0;
+    portEXIT_CRITICAL(&faceMux);
+    if (request->method() == HTTP_POST) {
+        if (count >= FACE_MAX_ENROLLED) {
+            request->send(507, "application/json", "{\"error\":\"table full\"}");
+            return;
+        }
+        if (!name.length()) name = "person" + String(count + 1);
+        uint32_t now = millis();
+        portENTER_CRITICAL(&faceMux);
+        strlcpy(faces.enrollName, name.c_str(), FACE_NAME_LEN);
+        faces.enrollSince = now;
+        faces.enrollPending = true;
+        portEXIT_CRITICAL(&faceMux);
+        request->send(202, "application/json", "{\"status\":\"enrolling\"}");
+        return;
+    }
+    if (request->method() == HTTP_DELETE) {
+        // A queued removal reorders the table, so our index could go stale
+        if (removing) {
+            request->send(409, "application/json", "{\"error\":\"removal in progress\"}");
+            return;
+        }
+        int index = FACE_MAX_ENROLLED;
+        if (name.length()) {
+            index = -1;
+            for (int i = 0; i < count; i++) if (name == names[i]) index = i;
+            if (index < 0) {
+                request->send(404, "application/json", "{\"error\":\"unknown name\"}");
+                return;
+            }
+        }
+        portENTER_CRITICAL(&faceMux);
+        faces.removePending = index;
+        portEXIT_CRITICAL(&faceMux);
+        request->send(202, "application/json", "{\"status\":\"removing\"}");
+        return;
+    }
+    StaticJsonDocument<1024> doc;
+    JsonArray enrolled = doc.createNestedArray("enrolled");
+    for (int i = 0; i < count; i++) enrolled.add(names[i]);
+    doc["capacity"] = FACE_MAX_ENROLLED;
+    doc["enrolling"] = enrolling;
+    doc["checks"] = faces.checks;
+    doc["known"] = faces.known;
+    doc["align_failures"] = faces.alignFailures;
+    String out; serializeJson(doc, out);
+    request->send(200, "application/json", out);
+}
+
 // ==========================================================
 // 🧠 NEURAL CORE
 // ==========================================================
-bool detectNeuralTarget(camera_fb_t * fb) {
-    if (!fb) return false;
-    dl_matrix3du_t *image_matrix = dl_matrix3du_alloc(1, fb->width, fb->height, 3);
-    if(!image_matrix) return false;
-    if(!fmt2rgb888(fb->buf, fb->len, fb->format, image_matrix->item)) {
-        dl_matrix3du_free(image_matrix);
-        return false;
+// decideTracks() hands each report here: digest always, ESP-NOW and a clip for new alerts.
+void reportTrack(Track * t, bool isNew, const DetectionResult &detections) {
+    int64_t serializeStart = esp_timer_get_time();
+    WireAlert alert = buildAlert(t, detections);
+    recordLatency(LAT_SERIALIZE, esp_timer_get_time() - serializeStart);
+    queueDigest(isNew ? WIRE_ALERT : WIRE_TRACK, &alert, wireAlertSize(alert.boxCount));
+    if (!isNew) return;
+    if constexpr (PROFILE.clips) {
+        WireClip clip = {t->id, triggerClip()};
+        if (clip.clipId) queueDigest(WIRE_CLIP, &clip, sizeof(clip));
     }
-    mtmn_config_t config = mtmn_init_config();
-    box_array_t *boxes = face_detect(image_matrix, &config);
-    bool targetFound = (boxes != NULL);
-    if(boxes) {
-        free(boxes->box);
-        free(boxes->landmark);
-        free(boxes);
+    flushDigest();
+    Serial.printf("[%s] -> TRACK %u CONFIRMED. ALERTING.\n", SECTOR, t->id);
+    if constexpr (PROFILE.espNow) {
+        queueEspNow(WIRE_ALERT, &alert, wireAlertSize(alert.boxCount));
+        flushEspNow();
     }
-    dl_matrix3du_free(image_matrix);
-    return targetFound;
+    health.alertsSent++;
 }
 
 void NeuralKernel(void * p) {
     uint32_t lastHeartbeat = 0;
+    uint32_t lastFrameSeq = 0;
+    DetectionResult detections;
     while(true) {
         runThermalCheck();
-        if (millis() - lastHeartbeat > 5000) {
-            sendEspNow(0);
+        int64_t frameStart = esp_timer_get_time();
+        stageTimes.gateUs = stageTimes.decodeUs = stageTimes.detectUs = 0;
+        if (millis() - lastHeartbeat > TELEMETRY_MS) {
+            queueTelemetry();
             lastHeartbeat = millis();
         }
         if (currentState != COOLING) {
-            camera_fb_t * fb = esp_camera_fb_get();
-            if (fb) {
+            BrokerFrame * frame = waitFrame(lastFrameSeq, 500);
+            stageTimes.captureUs = esp_timer_get_time() - frameStart;
+            if (frame && !detectorSizedFrame(frame->fb)) {
+                // /capture?res= holds the sensor: nothing to gate or detect at this size
+                lastFrameSeq = frame->seq;
+                streamCtl.heldFrames++;
+                releaseFrame(frame);
+            } else if (frame) {
+                camera_fb_t * fb = frame->fb;
+                lastFrameSeq = frame->seq;
                 health.framesProcessed++;
-                if (detectNeuralTarget(fb)) {
-                    humanVerificationCounter++;
-                    if (humanVerificationCounter >= 2) {
+                recordLatency(LAT_CAPTURE, stageTimes.captureUs);
+                int64_t gateStart = esp_timer_get_time();
+                // A hub burst means something is there: detect whatever the gate says
+                bool moving = motionGatePass(fb) || burstActive();
+                stageTimes.gateUs = esp_timer_get_time() - gateStart;
+                recordLatency(LAT_GATE, stageTimes.gateUs);
+                if (!moving) {
+                    // Static scene: previous verdict stands, skip decode + MTMN
+                } else {
+                    dl_matrix3du_t * image = nullptr;
+                    bool recognise = PROFILE.knownFaces && faces.enabled;
+                    detectNeuralTarget(fb, detections, recognise ? &image : nullptr);
+                    recordLatency(LAT_DECODE, stageTimes.decodeUs);
+                    recordLatency(LAT_DETECT, stageTimes.detectUs);
+                    // Without a kept frame (ROI mode) faces are aligned in their crops
+                    DecisionHooks hooks = {recognise ? identifyTracks : nullptr, ackBurst, reportTrack};
+                    int confirmed = decideTracks(image, detections, hooks);
+                    returnImageMatrix(image);
+                    if (confirmed) {
                         currentState = ANALYZING;
-                        StaticJsonDocument<256> doc;
-                        doc["event"] = "alert";
-                        doc["type"] = "HUMAN_TARGET";
-                        doc["cam_id"] = CAM_ID;
-                        doc["sector"] = SECTOR;
-                        doc["temp"] = health.temperature;
-                        char buffer[512];
-                        serializeJson(doc, buffer);
-                        webSocket.sendTXT(buffer);
-                        sendEspNow(1);
-                        health.alertsSent++;
                         digitalWrite(LED_STATUS, LOW);
-                        humanVerificationCounter = 0;
+                    } else {
+                        digitalWrite(LED_STATUS, HIGH);
+                        currentState = IDLE;
                     }
-                } else {
-                    digitalWrite(LED_STATUS, HIGH);
-                    currentState = IDLE;
-                    if (humanVerificationCounter > 0) humanVerificationCounter--;
                 }
-                esp_camera_fb_return(fb);
+                releaseFrame(frame);
             }
         }
-        int workload = (currentState == ANALYZING) ? 100 : 350;
-        if (activeStreams > 0) workload += 150; 
-        vTaskDelay(workload / portTICK_PERIOD_MS);
+        if (millis() - wsDigestLastFlush >= WS_DIGEST_MS) flushDigest();
+        ulTaskNotifyTake(pdTRUE, scheduleNextFrame(frameStart) / portTICK_PERIOD_MS);
     }
 }
 
+// ==========================================================
+// 📈 PROMETHEUS EXPORT (/metrics)
+// ==========================================================
+void printMetric(Print &out, const char * name, const char * type, const char * help, double value) {
+    out.printf("# HELP sentinel_%s %s\n# TYPE sentinel_%s %s\nsentinel_%s %.10g\n", name, help, name, type, name, value);
+}
+
+void metricsService(AsyncWebServerRequest *request) {
+    static LatencyHistogram snap[LAT_STAGES];    // Only ever served from async_tcp
+    portENTER_CRITICAL(&latencyMux);
+    memcpy(snap, latency, sizeof(snap));
+    portEXIT_CRITICAL(&latencyMux);
+
+    int slotsInUse = 0;
+    portENTER_CRITICAL(&brokerMux);
+    for (int i = 0; i < BROKER_SLOTS; i++) if (broker.slots[i].refs > 0) slotsInUse++;
+    portEXIT_CRITICAL(&brokerMux);
+
+    AsyncResponseStream *out = request->beginResponseStream("text/plain; version=0.0.4");
+    out->print("# HELP sentinel_stage_seconds Time spent per pipeline stage\n# TYPE sentinel_stage_seconds histogram\n");
+    for (int s = 0; s < LAT_STAGES; s++) {
+        const LatencyHistogram &h = snap[s];
+        uint32_t cumulative = 0;
+        for (int b = 0; b < LAT_BUCKETS; b++) {
+            cumulative += h.buckets[b];
+            out->printf("sentinel_stage_seconds_bucket{stage=\"%s\",le=\"%g\"} %u\n", LAT_STAGE_NAMES[s], latencyBound(b) / 1e6, cumulative);
+        }
+        out->printf("sentinel_stage_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %u\n", LAT_STAGE_NAMES[s], h.count);
+        out->printf("sentinel_stage_seconds_sum{stage=\"%s\"} %.6f\n", LAT_STAGE_NAMES[s], h.sumUs / 1e6);
+        out->printf("sentinel_stage_seconds_count{stage=\"%s\"} %u\n", LAT_STAGE_NAMES[s], h.count);
+    }
+    out->print("# HELP sentinel_stage_quantile_seconds Stage latency quantiles estimated from the histogram buckets\n# TYPE sentinel_stage_quantile_seconds gauge\n");
+    const float quantiles[] = {0.5f, 0.95f, 0.99f};
+    for (int s = 0; s < LAT_STAGES; s++) {
+        if (!snap[s].count) continue;
+        for (float q : quantiles) {
+            out->printf("sentinel_stage_quantile_seconds{stage=\"%s\",quantile=\"%g\"} %.6f\n", LAT_STAGE_NAMES[s], q, latencyQuantile(snap[s], q) / 1e6);
+        }
+    }
+
+    printMetric(*out, "heap_free_bytes", "gauge", "Free internal heap", ESP.getFreeHeap());
+    printMetric(*out, "heap_min_free_bytes", "gauge", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    printMetric(*out, "heap_max_alloc_bytes", "gauge", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+    printMetric(*out, "psram_free_bytes", "gauge", "Free PSRAM", ESP.getFreePsram());
+    printMetric(*out, "psram_size_bytes", "gauge", "Total PSRAM", ESP.getPsramSize());
+    printMetric(*out, "temperature_celsius", "gauge", "Die temperature", health.temperature);
+    printMetric(*out, "throttle_level", "gauge", "Thermal governor level", thermal.level);
+    printMetric(*out, "detect_fps", "gauge", "Achieved detection rate", sched.achievedFps);
+    printMetric(*out, "broker_slots_in_use", "gauge", "Frame broker slots holding a frame", slotsInUse);
+    printMetric(*out, "digest_pending_records", "gauge", "Records waiting in the WebSocket digest", wsDigest.records);
+    printMetric(*out, "espnow_pending_records", "gauge", "Records waiting in the ESP-NOW frame", espnowOut.records);
+    printMetric(*out, "stream_viewers", "gauge", "Connected /stream viewers", activeStreams);
+    printMetric(*out, "clip_readers", "gauge", "Connected /clip readers", clip.readers);
+    printMetric(*out, "frames_captured_total", "counter", "Frames published by the capture task", broker.published);
+    printMetric(*out, "broker_drops_total", "counter", "Frames dropped for want of a broker slot", broker.dropped);
+    printMetric(*out, "frames_processed_total", "counter", "Frames seen by the neural kernel", health.framesProcessed);
+    printMetric(*out, "gate_hits_total", "counter", "Frames the motion gate passed", motionGate.hits);
+    printMetric(*out, "gate_misses_total", "counter", "Frames the motion gate rejected", motionGate.misses);
+    printMetric(*out, "alerts_sent_total", "counter", "New-track alerts sent", health.alertsSent);
+    printMetric(*out, "faces_enrolled", "gauge", "People in the known-face table", faces.count);
+    printMetric(*out, "known_tracks_total", "counter", "Tracks recognised as enrolled and not alerted", faces.known);
+    printMetric(*out, "burst_active", "gauge", "1 while a hub burst is running", burstActive());
+    printMetric(*out, "bursts_total", "counter", "Hub burst commands accepted", burst.commands);
+    printMetric(*out, "deadlines_missed_total", "counter", "Detection frames over their period", sched.missed);
+    printMetric(*out, "image_pool_misses_total", "counter", "RGB matrices allocated outside the pool", imagePool.misses);
+    printMetric(*out, "jpeg_encode_failures_total", "counter", "Raw frames whose JPEG encode failed", jpegEnc.failures);
+    printMetric(*out, "stream_frames_skipped_total", "counter", "Frames a viewer skipped to stay on the latest", streamCtl.skippedTotal);
+    printMetric(*out, "stream_frames_detached_total", "counter", "Frames sent to slow viewers from a private copy", streamCtl.detachedTotal);
+    printMetric(*out, "detector_held_frames_total", "counter", "Frames skipped by the detector during /capture?res= holds", streamCtl.heldFrames);
+    printMetric(*out, "ws_digests_total", "counter", "Binary digests sent on the uplink", wsDigestsSent);
+    printMetric(*out, "ws_outbox_drops_total", "counter", "Digests lost to a full uplink outbox", wsOutbox.drops);
+    request->send(out);
+}
+
 void onWsEvent(WStype_t type, uint8_t * payload, size_t length) {
     switch(type) {
         case WStype_CONNECTED: Serial.println("CONNECTED TO BRAIN"); break;
         case WStype_DISCONNECTED: Serial.println("DISCONNECTED FROM BRAIN"); break;
+        case WStype_TEXT: Serial.printf("COMMAND_RX: %s\n", payload); break;
+        case WStype_BIN: handleHubCommand(payload, length); break;
     }
 }
 
@@ -289,51 +1829,158 @@ void setup() {
     config.pin_sscb_scl = SIOC_GPIO_NUM;
     config.pin_pwdn     = PWDN_GPIO_NUM;
     config.pin_reset    = RESET_GPIO_NUM;
-    config.xclk_freq_hz = 20000000;
-    config.pixel_format = PIXFORMAT_JPEG;
+    config.xclk_freq_hz = THROTTLE_STEPS[0].xclkMhz * 1000000;
+    // Raw QVGA frames need PSRAM, and raw ROI_FRAMESIZE frames would crowd out the clip ring
+    bool rawCapture = PROFILE.rawCapture && !ROI_DETECTION && psramFound();
+    config.pixel_format = rawCapture ? PIXFORMAT_RGB565 : PIXFORMAT_JPEG;
     
     if (psramFound()) {
-        config.frame_size = FRAMESIZE_QVGA;
+        config.frame_size = ROI_DETECTION ? ROI_FRAMESIZE : FRAMESIZE_QVGA;
         config.jpeg_quality = 10;
-        config.fb_count = 2;
+        config.fb_count = 3;    // Broker latest + detector + in-flight stream frame
     } else {
         config.frame_size = FRAMESIZE_CIF;
         config.jpeg_quality = 12;
         config.fb_count = 1;
+        Serial.println("CRITICAL: PSRAM NOT DETECTED. AI PERFORMANCE REDUCED.");
     }
 
-    esp_camera_init(&config);
-    WiFi.config(local_IP, gateway, subnet);
+    esp_err_t err = esp_camera_init(&config);
+    if (err != ESP_OK) {
+        Serial.printf("BOOT_FAILURE: 0x%x\n", err);
+        ESP.restart();
+    }
+    if (ROI_DETECTION && psramFound()) initRoiDetector();
+    if (!roi.enabled) initImagePool(config.frame_size);
+    broker.holdLatest = config.fb_count > 1;
+    broker.rawCapture = rawCapture;
+    if (rawCapture) initJpegEncoder();
+    if constexpr (PROFILE.clips) initClipRecorder();
+    initStreamController(config);
+    initMotionGate(config.frame_size);
+    if constexpr (PROFILE.knownFaces) {
+        if (psramFound()) initFaceTable();
+    }
+    if (!WiFi.config(local_IP, gateway, subnet)) {
+        Serial.println("PHASE_0: STATIC IP CONFIGURATION FAILED.");
+    }
     WiFi.begin(WIFI_SSID, WIFI_PASS);
-    while (WiFi.status() != WL_CONNECTED) delay(500);
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500); Serial.print(".");
+    }
+    Serial.println("\nPHASE_1: NETWORK ONLINE.");
     
-    MDNS.begin("pyramid-cam1");
-    server.on("/stream", HTTP_GET, streamService);
+    MDNS.begin(PROFILE.hostname);
+    if constexpr (PROFILE.streaming) server.on("/stream", HTTP_GET, streamService);
+    if constexpr (PROFILE.clips) server.on("/clip", HTTP_GET, clipService);
+    server.on("/capture", HTTP_GET | HTTP_POST, captureService);
+    server.on("/metrics", HTTP_GET, metricsService);
+    if constexpr (PROFILE.knownFaces) server.on("/faces", HTTP_GET | HTTP_POST | HTTP_DELETE, facesService);
     server.on("/status", HTTP_GET, [](AsyncWebServerRequest *r){
-        StaticJsonDocument<256> doc;
+        StaticJsonDocument<1536> doc;
         doc["cam_id"] = CAM_ID;
+        doc["sector"] = SECTOR;
         doc["temp"] = health.temperature;
+        doc["throttle"] = thermal.level;
+        doc["thermal_headroom"] = thermalHeadroom();
+        doc["throttle_steps"] = thermal.steps;
+        doc["cpu_mhz"] = thermal.cpuMhz;
+        doc["xclk_mhz"] = thermal.xclkMhz;
+        doc["heap"] = health.freeHeap;
+        doc["fps"]  = health.framesProcessed / (millis() / 1000.0);
+        doc["pool_hits"] = imagePool.hits;
+        doc["pool_misses"] = imagePool.misses;
+        doc["frame_pool_misses"] = imagePool.framePoolMisses;
+        doc["peak_frame_pool_misses"] = imagePool.peakFramePoolMisses;
+        doc["gate_hits"] = motionGate.hits;
+        doc["gate_misses"] = motionGate.misses;
+        doc["gate_delta"] = motionGate.lastPeakDelta;
+        doc["frames_captured"] = broker.published;
+        doc["broker_drops"] = broker.dropped;
+        doc["capture_format"] = broker.rawCapture ? "rgb565" : "jpeg";
+        doc["jpeg_encodes"] = jpegEnc.frames;
+        doc["jpeg_encode_us"] = jpegEnc.lastUs;
+        doc["jpeg_encode_failures"] = jpegEnc.failures;
+        doc["streams"] = activeStreams;
+        doc["clip_id"] = clip.clipId;
+        doc["clip_frames"] = clip.frameCount;
+        doc["detect_fps_target"] = sched.targetFps;
+        doc["detect_fps"] = sched.achievedFps;
+        doc["capture_us"] = stageTimes.captureUs;
+        doc["gate_us"] = stageTimes.gateUs;
+        doc["decode_us"] = stageTimes.decodeUs;
+        doc["detect_us"] = stageTimes.detectUs;
+        doc["deadlines_missed"] = sched.missed;
+        doc["deadlines"] = sched.deadlines;
+        doc["roi_regions"] = roi.lastRegions;
+        doc["roi_pixels"] = roi.lastPixels;
+        doc["ws_digests"] = wsDigestsSent;
+        doc["ws_outbox_drops"] = wsOutbox.drops;
+        doc["tracks"] = confirmedTracks();
+        doc["tracks_created"] = tracker.created;
+        doc["track_updates"] = tracker.updatesSent;
+        doc["alerts_suppressed"] = tracker.suppressed;
+        doc["faces_enrolled"] = faces.count;
+        doc["known_tracks"] = faces.known;
+        doc["burst_active"] = burstActive();
+        doc["bursts"] = burst.commands;
+        doc["jpeg_quality"] = streamCtl.quality;
+        doc["frame_size"] = (int)streamCtl.sensorSize;
+        doc["detector_held_frames"] = streamCtl.heldFrames;
+        JsonArray viewers = doc.createNestedArray("viewers");
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+            StreamClient &c = streamCtl.clients[i];
+            if (!c.used) continue;
+            JsonObject v = viewers.createNestedObject();
+            v["target_fps"] = c.targetFps;
+            v["fps"] = c.achievedFps;
+            v["delivery_ms"] = c.deliveryMs;
+            v["space"] = c.space;
+            v["skipped"] = c.skipped;
+            v["detached"] = c.detached;
+        }
         String out; serializeJson(doc, out);
         r->send(200, "application/json", out);
     });
     DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, DELETE, OPTIONS");
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "*");
+    // CORS preflights (the dashboard's DELETE /faces) get the headers above
+    server.onNotFound([](AsyncWebServerRequest *r){
+        if (r->method() == HTTP_OPTIONS) r->send(204);
+        else r->send(404, "application/json", "{\"error\":\"not found\"}");
+    });
     server.begin();
 
-    webSocket.begin(BRAIN_IP, 80, "/ws");
+    webSocket.begin(BRAIN_IP, PROFILE.uplinkPort, PROFILE.uplinkPath);
     webSocket.onEvent(onWsEvent);
     webSocket.setReconnectInterval(5000);
 
-    if (esp_now_init() == ESP_OK) {
-        esp_now_peer_info_t peerInfo;
-        memcpy(peerInfo.peer_addr, brain_mac, 6);
-        peerInfo.channel = 1;
-        peerInfo.encrypt = false;
-        esp_now_add_peer(&peerInfo);
+    if constexpr (PROFILE.espNow) {
+        if (esp_now_init() == ESP_OK) {
+            esp_now_peer_info_t peerInfo;
+            memcpy(peerInfo.peer_addr, brain_mac, 6);
+            peerInfo.channel = 1;
+            peerInfo.encrypt = false;
+            esp_now_add_peer(&peerInfo);
+            esp_now_register_recv_cb(onHubEspNow);
+        }
     }
 
+    xTaskCreatePinnedToCore(CaptureTask, "CAPTURE", 4096, NULL, 2, &Capture_Task_Handle, 1);
     xTaskCreatePinnedToCore(NeuralKernel, "AI_CORE", 12000, NULL, 1, &AI_Task_Handle, 0);
+
+    Serial.println("----------------------------------------");
+    Serial.println(" PYRAMID SENTINEL SYSTEM INITIALIZED ");
+    Serial.printf(" SECTOR: %s | NODE: %d | UPLINK: %s\n", SECTOR, CAM_ID, PROFILE.uplink == UPLINK_CORE ? "CORE" : "BRAIN");
+    Serial.println("----------------------------------------");
 }
 
 void loop() {
+    sendQueuedDigests();
     webSocket.loop();
+    if constexpr (PROFILE.streaming) adaptStreamQuality();
+    applySensorFrameSize();
+    applyThermalLimits();
+    health.uptime = millis() / 1000;
 }
@@ -19,6 +19,7 @@
  * -----------------------------------------------------------
  */
 
+#include <atomic>
 #include <WiFi.h>
 #include <esp_now.h>
 #include <ESPAsyncWebServer.h>
@@ -29,6 +30,9 @@
 #include <ArduinoOTA.h>
 #include <FFat.h>
 #include <ESPmDNS.h>
+#include "esp_timer.h"
+#include "sentinel_wire.h"
+#include "event_store.h"
 #include "soc/soc.h"
 #include "soc/rtc_cntl_reg.h"
 
@@ -74,6 +78,8 @@ struct NeuroState {
     uint32_t alertsReceived = 0;
     uint32_t camHeartbeats[4] = {0,0,0,0};
     uint32_t lastAlertTime[4] = {0,0,0,0}; // Tracks time of last alert per sector
+    uint8_t camThrottle[4] = {0,0,0,0};     // Thermal governor level per camera
+    uint8_t camCoverage[4] = {100,100,100,100}; // Detection rate per camera, % of unthrottled
     bool multiSectorBreach = false;          // Escalation flag
     size_t minHeap = 0;
     bool storageReady = false;
@@ -97,66 +103,354 @@ void playUnlocked() {
     pulseBuzzer(1200, 150);
 }
 
+// ==========================================================
+// ⚡ BURST TRIGGER (PIR / PROXIMITY -> CAMERAS)
+// ==========================================================
+// A PIR edge interrupts straight into BurstTask, which sends one WIRE_BURST
+// command by ESP-NOW broadcast and to every camera's WebSocket (cameras
+// drop the repeat by burstId). The ultrasonic ranging timer requests one
+// when something comes into range. Cameras acknowledge their first burst inference, and
+// edge-to-ack time (PIR-to-inference plus the hop back) is tracked per
+// camera against BURST_BUDGET_MS.
+#define BURST_DURATION_MS   5000
+#define BURST_REFIRE_MS     2000    // Trips closer together than this ride the running burst
+#define BURST_BUDGET_MS     150     // PIR edge -> first camera inference
+#define PIR_BURST_CAMS      0x0E    // Bit n = camera n
+#define PROX_BURST_CAMS     0x0E
+
+struct BurstTrigger {
+    uint8_t pendingMask = 0;    // Cameras owed a command (set from the ISR)
+    int64_t pendingUs = 0;      // First trip since the last command
+    uint16_t id = 0;            // id, sentTripUs and the ack fields change under burstMux
+    int64_t sentTripUs = 0;     // Trip time of the command in flight
+    uint32_t lastSentMs = 0;
+    uint32_t sent = 0;
+    uint16_t ackedId[4] = {0};
+    uint32_t latencyMs[4] = {0};   // Last trip-to-ack per camera
+    uint32_t worstMs = 0;
+    uint32_t overBudget = 0;
+} burst;
+
+portMUX_TYPE burstMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t Burst_Task_Handle = NULL;
+
+uint32_t camWsClient[4] = {0, 0, 0, 0};     // AsyncWebSocket client id per camera, 0 = none
+const uint8_t BROADCAST_MAC[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+void IRAM_ATTR onPirEdge() {
+    portENTER_CRITICAL_ISR(&burstMux);
+    if (!burst.pendingMask) burst.pendingUs = esp_timer_get_time();
+    burst.pendingMask |= PIR_BURST_CAMS;
+    portEXIT_CRITICAL_ISR(&burstMux);
+    BaseType_t woken = pdFALSE;
+    if (Burst_Task_Handle) vTaskNotifyGiveFromISR(Burst_Task_Handle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void requestBurst(uint8_t mask) {
+    portENTER_CRITICAL(&burstMux);
+    if (!burst.pendingMask) burst.pendingUs = esp_timer_get_time();
+    burst.pendingMask |= mask;
+    portEXIT_CRITICAL(&burstMux);
+    if (Burst_Task_Handle) xTaskNotifyGive(Burst_Task_Handle);
+}
+
+void sendBurst(uint8_t mask, int64_t tripUs) {
+    portENTER_CRITICAL(&burstMux);
+    uint16_t id = ++burst.id;
+    burst.sentTripUs = tripUs;
+    portEXIT_CRITICAL(&burstMux);
+    WireWriter out;
+    WireBurst cmd = {id, mask, BURST_DURATION_MS};
+    wireAppend(out, WIRE_BURST, &cmd, sizeof(cmd));
+    size_t len = wireFinish(out, WIRE_HUB_ID, millis());
+    esp_now_send(BROADCAST_MAC, out.buf, len);
+    for (int cid = 1; cid <= 3; cid++) {
+        if ((mask & (1 << cid)) && camWsClient[cid]) ws.binary(camWsClient[cid], out.buf, len);
+    }
+    burst.sent++;
+    burst.lastSentMs = millis();
+}
+
+void BurstTask(void * p) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&burstMux);
+        uint8_t mask = burst.pendingMask;
+        int64_t tripUs = burst.pendingUs;
+        burst.pendingMask = 0;
+        portEXIT_CRITICAL(&burstMux);
+        if (!mask || !sys.armed) continue;
+        if (burst.sent && millis() - burst.lastSentMs < BURST_REFIRE_MS) continue;
+        sendBurst(mask, tripUs);
+    }
+}
+
+// First ack per camera for the command in flight; later repeats are ignored.
+// Called from both the ESP-NOW ingest and async_tcp tasks.
+void noteBurstAck(int cid, const WireBurstAck &ack) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&burstMux);
+    if (ack.burstId != burst.id || burst.ackedId[cid] == ack.burstId) {
+        portEXIT_CRITICAL(&burstMux);
+        return;
+    }
+    burst.ackedId[cid] = ack.burstId;
+    uint32_t ms = (now - burst.sentTripUs) / 1000;
+    burst.latencyMs[cid] = ms;
+    if (ms > burst.worstMs) burst.worstMs = ms;
+    if (ms > BURST_BUDGET_MS) burst.overBudget++;
+    portEXIT_CRITICAL(&burstMux);
+    Serial.printf("[SENTINEL] BURST %u CAM_%d: TRIP->INFERENCE %ums (CAM %uus)\n", ack.burstId, cid, ms, ack.rxToInferUs);
+}
+
 // ==========================================================
 // � ESP-NOW PROTOCOL (ULTRA-LOW LATENCY)
 // ==========================================================
-typedef struct {
-    int id;
-    int type; // 0=HEARTBEAT, 1=ALERT
-    float temp;
-    uint32_t heap;
-} esp_now_data_t;
+// Frames are sentinel_wire.h batches; each one is length-checked before any
+// record is read, and per-camera sequence gaps are counted as lost frames
+// (wireAcceptSeq; a rebooted camera resyncs its link).
+// The WiFi driver callback only copies a frame into a lock-free single-
+// producer/single-consumer ring. EspNowIngestTask drains it in batches:
+// decode, apply the batch to `sys` under one stateMutex hold, then fan the
+// records out to the dashboard. Nothing on the radio path waits on TCP or
+// a lock; when the ring is full the newest frame is dropped and counted.
+#define ESPNOW_RING_SLOTS   16      // Power of two
+#define ESPNOW_BATCH        8       // Frames per ingest pass
+
+struct EspNowSlot {
+    uint8_t len;
+    uint8_t data[WIRE_FRAME_MAX];
+};
 
+struct EspNowRing {
+    EspNowSlot slots[ESPNOW_RING_SLOTS];
+    std::atomic<uint32_t> head{0};  // Written by the WiFi callback only
+    std::atomic<uint32_t> tail{0};  // Written by the ingest task only
+    uint32_t drops = 0;             // Ring full
+    uint32_t highWater = 0;         // Most frames ever waiting
+    uint32_t batches = 0;
+} espnowRing;
+
+TaskHandle_t Ingest_Task_Handle = NULL;
+WireLink espnowLinks[4];
+uint32_t espnowRejected = 0;    // Malformed, foreign or wrong-version frames
+
+void forwardHeartbeat(int cid, const WireHeartbeat &hb, bool thermal) {
+    StaticJsonDocument<256> doc;
+    doc["event"] = "heartbeat";
+    doc["cid"]   = cid;
+    doc["temp"]  = hb.tempCenti / 100.0;
+    doc["heap"]  = hb.freeHeap;
+    doc["uptime"] = hb.uptimeS;
+    if (thermal) {
+        doc["throttle"] = hb.throttle;
+        doc["headroom"] = hb.headroomCenti / 100.0;
+        doc["coverage"] = hb.coveragePct;
+    }
+    String out;
+    serializeJson(doc, out);
+    ws.textAll(out);
+}
+
+void forwardAlert(int cid, const WireAlert &alert) {
+    Serial.println("[SENTINEL] ESP_NOW_ALERT_SECTOR_" + String(cid));
+
+    // Forward to WebSocket Dashboard
+    StaticJsonDocument<512> doc;
+    doc["event"] = "alert";
+    doc["type"]  = "ESP_NOW_HUMAN_TARGET";
+    doc["cid"]   = cid;
+    doc["temp"]  = alert.tempCenti / 100.0;
+    doc["track"] = alert.trackId;
+    doc["age_ms"] = alert.ageMs;
+    JsonArray boxes = doc.createNestedArray("boxes");
+    for (int i = 0; i < alert.boxCount; i++) {
+        JsonArray b = boxes.createNestedArray();
+        b.add(alert.boxes[i].x1);
+        b.add(alert.boxes[i].y1);
+        b.add(alert.boxes[i].x2);
+        b.add(alert.boxes[i].y2);
+    }
+    String out;
+    serializeJson(doc, out);
+    ws.textAll(out);
+}
+
+void forwardStats(int cid, const WireStats &st) {
+    StaticJsonDocument<256> doc;
+    doc["event"] = "cam_stats";
+    doc["cid"]   = cid;
+    doc["frames"] = st.framesProcessed;
+    doc["alerts"] = st.alertsSent;
+    doc["gate_hits"] = st.gateHits;
+    doc["gate_misses"] = st.gateMisses;
+    doc["detect_us"] = st.detectUs;
+    doc["detect_fps"] = st.detectFpsX10 / 10.0;
+    doc["tracks"] = st.tracks;
+    String out;
+    serializeJson(doc, out);
+    ws.textAll(out);
+}
+
+// WiFi driver context: length check, copy, publish. Nothing else.
 void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len) {
-    esp_now_data_t data;
-    memcpy(&data, incomingData, sizeof(data));
-    
-    int cid = data.id;
-    if (cid >= 1 && cid <= 3) {
-        sys.camHeartbeats[cid] = millis();
-        
-        if (data.type == 1) { // ALERT
-            sys.lastAlertTime[cid] = millis();
-            sys.lastEvent = "ESP_NOW_ALERT_SECTOR_" + String(cid);
-            Serial.println("[SENTINEL] " + sys.lastEvent);
-            
-            // Forward to WebSocket Dashboard
-            StaticJsonDocument<256> doc;
-            doc["event"] = "alert";
-            doc["type"]  = "ESP_NOW_HUMAN_TARGET";
-            doc["cid"]   = cid;
-            doc["temp"]  = data.temp;
-            String out;
-            serializeJson(doc, out);
-            ws.textAll(out);
-        } else if (data.type == 0) { // HEARTBEAT
-            // Forward heartbeat temperature to dashboard
-            StaticJsonDocument<256> doc;
-            doc["event"] = "heartbeat";
-            doc["cid"]   = cid;
-            doc["temp"]  = data.temp;
-            String out;
-            serializeJson(doc, out);
-            ws.textAll(out);
-        }
+    if (len < (int) sizeof(WireHeader) || len > WIRE_FRAME_MAX) {
+        espnowRejected++;
+        return;
+    }
+    uint32_t head = espnowRing.head.load(std::memory_order_relaxed);
+    uint32_t waiting = head - espnowRing.tail.load(std::memory_order_acquire);
+    if (waiting >= ESPNOW_RING_SLOTS) {
+        espnowRing.drops++;
+        return;
     }
+    EspNowSlot &slot = espnowRing.slots[head & (ESPNOW_RING_SLOTS - 1)];
+    slot.len = len;
+    memcpy(slot.data, incomingData, len);
+    espnowRing.head.store(head + 1, std::memory_order_release);
+    if (waiting + 1 > espnowRing.highWater) espnowRing.highWater = waiting + 1;
+    if (Ingest_Task_Handle) xTaskNotifyGive(Ingest_Task_Handle);
+}
+
+struct IngestFrame {
+    int cid;
+    int count;
+    WireRecord records[16];
+};
+
+void EspNowIngestTask(void * p) {
+    static EspNowSlot batch[ESPNOW_BATCH];      // Ring slots are released before any decoding
+    static IngestFrame frames[ESPNOW_BATCH];
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, 100 / portTICK_PERIOD_MS);
+        while (true) {
+            uint32_t tail = espnowRing.tail.load(std::memory_order_relaxed);
+            uint32_t head = espnowRing.head.load(std::memory_order_acquire);
+            int n = min(head - tail, (uint32_t) ESPNOW_BATCH);
+            if (n == 0) break;
+            for (int i = 0; i < n; i++) {
+                const EspNowSlot &slot = espnowRing.slots[(tail + i) & (ESPNOW_RING_SLOTS - 1)];
+                batch[i].len = slot.len;
+                memcpy(batch[i].data, slot.data, slot.len);
+            }
+            espnowRing.tail.store(tail + n, std::memory_order_release);
+            espnowRing.batches++;
+
+            // Decode and sequence-check (ingest-only state, no lock)
+            int accepted = 0;
+            for (int i = 0; i < n; i++) {
+                WireHeader hdr;
+                IngestFrame &f = frames[accepted];
+                if (wireDecode(batch[i].data, batch[i].len, hdr, f.records, 16, f.count) != WIRE_OK || hdr.camId < 1 || hdr.camId > 3) {
+                    espnowRejected++;
+                    continue;
+                }
+                WireHeartbeat hb;
+                bool hasHb = false;
+                for (int k = 0; k < f.count && !hasHb; k++) {
+                    if (f.records[k].type == WIRE_HEARTBEAT) hasHb = wireReadHeartbeat(f.records[k], hb);
+                }
+                if (!wireAcceptSeq(espnowLinks[hdr.camId], hdr, hasHb ? &hb : nullptr)) continue;
+                f.cid = hdr.camId;
+                accepted++;
+            }
+            if (!accepted) continue;
 
+            // One short hold for the whole batch
+            if (xSemaphoreTake(stateMutex, portMAX_DELAY)) {
+                uint32_t now = millis();
+                for (int i = 0; i < accepted; i++) {
+                    const IngestFrame &f = frames[i];
+                    sys.camHeartbeats[f.cid] = now;
+                    for (int k = 0; k < f.count; k++) {
+                        const WireRecord &r = f.records[k];
+                        WireHeartbeat hb;
+                        if (r.type == WIRE_HEARTBEAT && wireReadHeartbeat(r, hb)) {
+                            sys.camThrottle[f.cid] = hb.throttle;
+                            sys.camCoverage[f.cid] = hb.coveragePct;
+                        } else if (r.type == WIRE_ALERT) {
+                            sys.lastAlertTime[f.cid] = now;
+                            sys.lastEvent = "ESP_NOW_ALERT_SECTOR_" + String(f.cid);
+                        }
+                    }
+                }
+                xSemaphoreGive(stateMutex);
+            }
+
+            // Fan-out to the dashboard, outside the lock
+            for (int i = 0; i < accepted; i++) {
+                const IngestFrame &f = frames[i];
+                for (int k = 0; k < f.count; k++) {
+                    const WireRecord &r = f.records[k];
+                    if (r.type == WIRE_HEARTBEAT) {
+                        WireHeartbeat hb;
+                        if (wireReadHeartbeat(r, hb)) forwardHeartbeat(f.cid, hb, r.len >= sizeof(WireHeartbeat));
+                    } else if (r.type == WIRE_ALERT) {
+                        WireAlert alert;
+                        if (wireReadAlert(r, alert)) forwardAlert(f.cid, alert);
+                    } else if (r.type == WIRE_STATS) {
+                        WireStats st;
+                        if (wireRead(r, st)) forwardStats(f.cid, st);
+                    } else if (r.type == WIRE_BURST_ACK) {
+                        WireBurstAck ack;
+                        if (wireRead(r, ack)) noteBurstAck(f.cid, ack);
+                    }
+                }
+            }
+        }
+    }
 }
 
 // ==========================================================
 // 💾 PERSISTENCE & LOGGING ENGINE
 // ==========================================================
 
-void addLog(String msg) {
-    sys.lastEvent = msg;
-    Serial.println("[SENTINEL] " + msg);
-    if (sys.storageReady) {
-        File f = FFat.open("/pyramid.log", FILE_APPEND);
-        if (f) {
-            f.printf("[%lu] %s\n", millis(), msg.c_str());
-            f.close();
-        }
+// Events go to the binary event store (main/event_store.h); addLog() only
+// copies into its RAM ring, and EventFlushTask commits it to flash and
+// echoes it to Serial. sys.lastEvent is a String every task touches, so it
+// is only assigned and copied under stateMutex.
+void addLog(String msg, uint8_t level = EV_INFO) {
+    if (xSemaphoreTake(stateMutex, portMAX_DELAY)) {
+        sys.lastEvent = msg;
+        xSemaphoreGive(stateMutex);
+    }
+    if (sys.storageReady) eventAppend(level, msg.c_str(), msg.length());
+    else Serial.println("[SENTINEL] " + msg);
+}
+
+String lastEvent() {
+    String copy;
+    if (xSemaphoreTake(stateMutex, portMAX_DELAY)) {
+        copy = sys.lastEvent;
+        xSemaphoreGive(stateMutex);
     }
+    return copy;
+}
+
+// ==========================================================
+// 🎞️ ALERT CLIP GALLERY
+// ==========================================================
+// Cameras attach a /clip URL to alerts; the newest ones back /gallery.json.
+#define GALLERY_SLOTS 16
+
+struct GalleryClip {
+    int cid = 0;
+    uint32_t ts = 0;
+    String url;
+};
+
+GalleryClip gallery[GALLERY_SLOTS];
+int galleryHead = 0;
+int galleryCount = 0;
+
+void addGalleryClip(int cid, const String &url) {
+    GalleryClip &g = gallery[galleryHead];
+    g.cid = cid;
+    g.ts = millis();
+    g.url = url;
+    galleryHead = (galleryHead + 1) % GALLERY_SLOTS;
+    if (galleryCount < GALLERY_SLOTS) galleryCount++;
 }
 
 // ==========================================================
@@ -306,8 +600,10 @@ void renderDashboard() {
         tft.fillRect(15 + (i * 105), 150, 100, 20, active ? 0x0421 : 0x2000); // Widened since 3 cams
         tft.drawRect(15 + (i * 105), 150, 100, 20, active ? ILI9341_GREEN : 0x4000);
         tft.setCursor(20 + (i * 105), 156);
-        tft.setTextColor(active ? ILI9341_WHITE : 0x7BEF);
-        tft.printf("CAM %d: %s", i+1, active ? "ON" : "OFF");
+        bool throttled = active && sys.camThrottle[i+1] > 0;
+        tft.setTextColor(throttled ? ILI9341_ORANGE : (active ? ILI9341_WHITE : 0x7BEF));
+        if (throttled) tft.printf("CAM %d: T%d", i+1, sys.camThrottle[i+1]);
+        else tft.printf("CAM %d: %s", i+1, active ? "ON" : "OFF");
     }
 
     // 7. TERMINAL LOG
@@ -317,56 +613,220 @@ void renderDashboard() {
     tft.setTextColor(0x07E0); // Matrix Green
     tft.setTextSize(1);
     tft.print("> ");
-    tft.print(sys.lastEvent);
+    tft.print(lastEvent());
 }
 
 // ==========================================================
-// 🧠 INTELLIGENCE ENGINE (CORE 0)
+// 📏 ULTRASONIC RANGING (TIMER + ECHO INTERRUPT)
 // ==========================================================
+// An esp_timer fires the trigger pulse every 1/RANGE_HZ s and the echo pin
+// interrupt timestamps both edges, so nothing waits in pulseIn(). Each tick
+// settles the previous ping (no falling edge by then means no echo) into a
+// RANGE_WINDOW window. The distance is the median of the pings that echoed,
+// and "no target" (0) unless most of the window echoed, so dropouts never
+// pull the reading towards zero and a single spurious echo never stands.
+// Only the filtered distance is published; the intelligence loop copies it
+// into `sys`. The camera burst fires as soon as something comes into range.
+#define RANGE_HZ            20
+#define RANGE_WINDOW        5       // Pings per median (odd)
+#define RANGE_MAX_ECHO_US   26000   // ~4.4 m; anything longer counts as no echo
+#define PROX_ALERT_CM       30.0f
+static_assert(1000000 / RANGE_HZ > RANGE_MAX_ECHO_US, "RANGE_HZ leaves no time for the echo");
+
+struct Ranger {
+    volatile int64_t riseUs = 0;
+    volatile uint32_t echoUs = 0;       // Last complete echo since the trigger, 0 = none
+    float window[RANGE_WINDOW] = {0};
+    int next = 0;
+    volatile float filteredCm = 0;
+    bool near = false;
+    uint32_t pings = 0;
+    uint32_t echoes = 0;
+} ranger;
+
+void IRAM_ATTR onEchoEdge() {
+    int64_t now = esp_timer_get_time();
+    if (digitalRead(PIN_US_ECHO)) {
+        ranger.riseUs = now;
+    } else if (ranger.riseUs) {
+        ranger.echoUs = now - ranger.riseUs;
+        ranger.riseUs = 0;
+    }
+}
+
+// esp_timer task: settle the last ping, then send the next one.
+void rangeTick(void * arg) {
+    uint32_t echo = ranger.echoUs;
+    ranger.echoUs = 0;
+    ranger.riseUs = 0;
+    if (echo && echo <= RANGE_MAX_ECHO_US) ranger.echoes++;
+    else echo = 0;
+    ranger.window[ranger.next] = echo * 0.034f / 2;
+    ranger.next = (ranger.next + 1) % RANGE_WINDOW;
+    ranger.pings++;
+
+    float sorted[RANGE_WINDOW];
+    int n = 0;
+    for (int i = 0; i < RANGE_WINDOW; i++) {
+        float v = ranger.window[i];
+        if (v <= 0) continue;
+        int j = n++;
+        for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+    float cm = n > RANGE_WINDOW / 2 ? sorted[n / 2] : 0;
+    ranger.filteredCm = cm;
+
+    // Burst the cameras on the way in, not on every ping while something stays there
+    bool near = cm > 0 && cm < PROX_ALERT_CM;
+    if (near && !ranger.near && sys.armed) requestBurst(PROX_BURST_CAMS);
+    ranger.near = near;
+
+    digitalWrite(PIN_US_TRIG, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(PIN_US_TRIG, LOW);
+}
+
+void initRanging() {
+    digitalWrite(PIN_US_TRIG, LOW);
+    attachInterrupt(digitalPinToInterrupt(PIN_US_ECHO), onEchoEdge, CHANGE);
+    esp_timer_create_args_t args = {};
+    args.callback = rangeTick;
+    args.name = "ranging";
+    esp_timer_handle_t timer;
+    if (esp_timer_create(&args, &timer) == ESP_OK) esp_timer_start_periodic(timer, 1000000 / RANGE_HZ);
+}
+
+// ==========================================================
+// 🛰️ STATE BROADCAST (VERSIONED DELTAS)
+// ==========================================================
+// Dashboards keep a copy of the broadcast fields. Each change bumps the
+// version and goes out as a state_update carrying `v` and only the fields
+// that changed; a client that joins (or sends STATE_SNAPSHOT after seeing a
+// gap in `v`) gets every field with "full": true. Proximity and temperature
+// only count as changed past a dead band, so an idle system sends nothing.
+// broadcastState() is cheap when nothing moved: the intelligence loop calls
+// it every tick, and arm/threat changes call it the moment they happen.
+#define STATE_PROX_DEADBAND     2.0f    // cm
+#define STATE_TEMP_DEADBAND     0.5f    // °C
+
+enum StateField : uint8_t {
+    SF_ARMED  = 1 << 0,
+    SF_THREAT = 1 << 1,
+    SF_PROX   = 1 << 2,
+    SF_TEMP   = 1 << 3,
+    SF_LOG    = 1 << 4,
+    SF_ALL    = 0x1F,
+};
+
+struct PublishedState {
+    uint32_t version = 0;
+    bool armed = false;         // Values as last broadcast
+    int threat = -1;
+    float prox = -1;
+    float temp = -100;
+    String log;
+    uint32_t deltas = 0;
+    uint32_t snapshots = 0;
+} published;
+
+SemaphoreHandle_t publishMutex = NULL;
+
+void fillState(JsonDocument &doc, uint8_t fields, bool full) {
+    doc["event"] = "state_update";
+    doc["v"] = published.version;
+    if (full) doc["full"] = true;
+    if (fields & SF_ARMED) doc["armed"] = published.armed;
+    if (fields & SF_THREAT) doc["threat"] = published.threat;
+    if (fields & SF_PROX) doc["prox"] = published.prox;
+    if (fields & SF_TEMP) doc["temp"] = published.temp;
+    if (fields & SF_LOG) doc["log"] = published.log;
+}
+
+// Caller holds publishMutex. Fold `sys` into `published` and broadcast what changed.
+void publishChanges() {
+    uint8_t changed = 0;
+    if (published.version == 0 || sys.armed != published.armed) changed |= SF_ARMED;
+    if (sys.threatLevel != published.threat) changed |= SF_THREAT;
+    if (fabsf(sys.proximity - published.prox) >= STATE_PROX_DEADBAND || (sys.proximity == 0) != (published.prox == 0)) changed |= SF_PROX;
+    if (fabsf(sys.coreTemp - published.temp) >= STATE_TEMP_DEADBAND) changed |= SF_TEMP;
+    String log = lastEvent();
+    if (log != published.log) changed |= SF_LOG;
+    if (!changed) return;
+
+    published.version++;
+    published.armed = sys.armed;
+    published.threat = sys.threatLevel;
+    if (changed & SF_PROX) published.prox = sys.proximity;
+    if (changed & SF_TEMP) published.temp = sys.coreTemp;
+    if (changed & SF_LOG) published.log = log;
+    published.deltas++;
+
+    StaticJsonDocument<512> doc;
+    fillState(doc, changed, false);
+    String out;
+    serializeJson(doc, out);
+    ws.textAll(out);
+}
 
 void broadcastState() {
+    if (!publishMutex || !xSemaphoreTake(publishMutex, portMAX_DELAY)) return;
+    publishChanges();
+    xSemaphoreGive(publishMutex);
+}
+
+// Everything, at the current version, for one client (joined, or resyncing after a gap).
+void sendStateSnapshot(AsyncWebSocketClient * client) {
+    if (!publishMutex || !xSemaphoreTake(publishMutex, portMAX_DELAY)) return;
+    publishChanges();
     StaticJsonDocument<512> doc;
-    doc["event"] = "state_update";
-    doc["armed"] = sys.armed;
-    doc["threat"] = sys.threatLevel;
-    doc["prox"] = sys.proximity;
-    doc["temp"] = sys.coreTemp;
-    doc["log"] = sys.lastEvent;
-    
-    char buffer[512];
-    serializeJson(doc, buffer);
-    ws.textAll(buffer);
+    fillState(doc, SF_ALL, true);
+    published.snapshots++;
+    xSemaphoreGive(publishMutex);
+    String out;
+    serializeJson(doc, out);
+    client->text(out);
 }
 
+// ==========================================================
+// 🧠 INTELLIGENCE ENGINE (CORE 0)
+// ==========================================================
+
 void IntelligenceTask(void * p) {
     while(true) {
+        // Sensor reads, flash logging, the siren and the broadcast all stay outside the lock
+        float range = ranger.filteredCm;
+        bool pir = digitalRead(PIN_PIR1) || digitalRead(PIN_PIR2);
+        float temp = temperatureRead();
+        size_t heap = ESP.getFreeHeap();
+        String events[3];
+        uint8_t eventLevels[3];
+        int eventCount = 0;
+        bool alarm = false, breach = false, armed = false;
+
         if(xSemaphoreTake(stateMutex, portMAX_DELAY)) {
-            // PROXIMITY SCAN
-            digitalWrite(PIN_US_TRIG, LOW); delayMicroseconds(2);
-            digitalWrite(PIN_US_TRIG, HIGH); delayMicroseconds(10);
-            digitalWrite(PIN_US_TRIG, LOW);
-            long dur = pulseIn(PIN_US_ECHO, HIGH, 26000);
-            sys.proximity = (dur * 0.034) / 2;
-
-            if(sys.proximity < 30.0 && sys.proximity > 0 && sys.armed) {
+            // PROXIMITY (filtered by the ranging timer)
+            sys.proximity = range;
+            if(range < PROX_ALERT_CM && range > 0 && sys.armed) {
                 sys.threatLevel += 10;
-                addLog("PROX_ALERT: OBJ @ " + String(sys.proximity) + "cm | THREAT: " + String(sys.threatLevel));
+                eventLevels[eventCount] = EV_WARN;
+                events[eventCount++] = "PROX_ALERT: OBJ @ " + String(range) + "cm | THREAT: " + String(sys.threatLevel);
             }
 
             // PIR SENSOR FUSION
-            if((digitalRead(PIN_PIR1) || digitalRead(PIN_PIR2)) && sys.armed) {
+            if(pir && sys.armed) {
                 sys.threatLevel += 15;
-                addLog("LOCAL_MOTION: PIR_TRIP | THREAT: " + String(sys.threatLevel));
+                eventLevels[eventCount] = EV_WARN;
+                events[eventCount++] = "LOCAL_MOTION: PIR_TRIP | THREAT: " + String(sys.threatLevel);
             }
 
             // THERMAL TRACKING (use core helper, returns °C directly)
-            sys.coreTemp = temperatureRead();
+            sys.coreTemp = temp;
 
             // THREAT DECAY
             if(sys.threatLevel > 100) sys.threatLevel = 100;
             if(sys.threatLevel > 0) sys.threatLevel--;
-            
-            sys.minHeap = ESP.getFreeHeap();
+            sys.minHeap = heap;
 
             // --- MULTI-SECTOR THREAT FUSION ENGINE ---
             int recentActiveAlerts = 0;
@@ -374,41 +834,156 @@ void IntelligenceTask(void * p) {
                 if(millis() - sys.lastAlertTime[i] < 10000) recentActiveAlerts++;
             }
             if(recentActiveAlerts >= 2 && sys.armed) {
-                if(!sys.multiSectorBreach) addLog("MULTI_SECTOR_BREACH_DETECTED");
+                if(!sys.multiSectorBreach) {
+                    eventLevels[eventCount] = EV_ALERT;
+                    events[eventCount++] = "MULTI_SECTOR_BREACH_DETECTED";
+                }
                 sys.multiSectorBreach = true;
                 sys.threatLevel = 100; // Force Maximum Threat
             } else {
                 sys.multiSectorBreach = false;
             }
+            armed = sys.armed;
+            alarm = sys.threatLevel > 80 && armed;
+            breach = sys.multiSectorBreach;
+            xSemaphoreGive(stateMutex);
+        }
 
-            // VISUAL ESCALATION
-            if(sys.threatLevel > 80 && sys.armed) {
-                digitalWrite(PIN_RED_LED, HIGH);
-                digitalWrite(PIN_GREEN_LED, LOW);
-                
-                // TITANIUM SIREN ESCALATION
-                if(sys.multiSectorBreach) {
-                    if((millis()/100)%2) pulseBuzzer(3800, 50); else pulseBuzzer(2200, 50);
-                } else if((millis()/200)%2) pulseBuzzer(2500, 50);
-            } else {
-                digitalWrite(PIN_RED_LED, LOW);
-                digitalWrite(PIN_GREEN_LED, sys.armed ? HIGH : LOW);
-            }
+        for (int i = 0; i < eventCount; i++) addLog(events[i], eventLevels[i]);
 
-            broadcastState();
-            xSemaphoreGive(stateMutex);
+        // VISUAL ESCALATION
+        if(alarm) {
+            digitalWrite(PIN_RED_LED, HIGH);
+            digitalWrite(PIN_GREEN_LED, LOW);
+            
+            // TITANIUM SIREN ESCALATION
+            if(breach) {
+                if((millis()/100)%2) pulseBuzzer(3800, 50); else pulseBuzzer(2200, 50);
+            } else if((millis()/200)%2) pulseBuzzer(2500, 50);
+        } else {
+            digitalWrite(PIN_RED_LED, LOW);
+            digitalWrite(PIN_GREEN_LED, armed ? HIGH : LOW);
         }
+
+        broadcastState();
         vTaskDelay(300 / portTICK_PERIOD_MS);
     }
 }
 
+// ==========================================================
+// 📨 CAMERA UPLINK DIGESTS
+// ==========================================================
+// Cameras batch alerts, track updates, clip ids and telemetry into binary
+// sentinel_wire.h digests on the WebSocket; JSON alerts are still accepted.
+const char * SECTOR_NAMES[] = {"UNKNOWN", "NORTH", "EAST", "SOUTH", "WEST"};
+uint32_t digestsReceived = 0;
+uint32_t digestsRejected = 0;
+
+// Camera uplinks arrive on the WebSocket task; like the ESP-NOW ingest they
+// change `sys` under stateMutex and log, broadcast and sound the buzzer
+// after releasing it.
+
+// Caller holds stateMutex.
+void touchCamSector(int cid) {
+    if (cid >= 1 && cid <= 3) {
+        sys.camHeartbeats[cid] = millis();
+        sys.lastAlertTime[cid] = millis();
+    }
+}
+
+// Caller holds stateMutex. Returns the raised threat level.
+int applyCamAlert(int cid) {
+    sys.threatLevel += 20;
+    touchCamSector(cid);
+    return sys.threatLevel;
+}
+
+void logCamAlert(const String &sector, const String &type, uint32_t track, int threat) {
+    addLog("[SEC_" + sector + "] - " + type + " #" + String(track) + " | LVL: " + String(threat), EV_ALERT);
+}
+
+void registerCamAlert(int cid, const String &sector, const String &type, uint32_t track) {
+    int threat = 0;
+    if (xSemaphoreTake(stateMutex, portMAX_DELAY)) {
+        threat = applyCamAlert(cid);
+        xSemaphoreGive(stateMutex);
+    }
+    logCamAlert(sector, type, track, threat);
+    broadcastState();
+    pulseBuzzer(3000, 100);
+}
+
+// Throttled update for a target that already alerted: keeps the
+// sector hot without escalating the threat level again
+void refreshCamTrack(int cid) {
+    if (xSemaphoreTake(stateMutex, portMAX_DELAY)) {
+        touchCamSector(cid);
+        xSemaphoreGive(stateMutex);
+    }
+}
+
+void handleCamDigest(const uint8_t * data, size_t len, const IPAddress &camIp, uint32_t clientId) {
+    WireHeader hdr;
+    WireRecord records[32];
+    int count = 0;
+    if (wireDecode(data, len, hdr, records, 32, count) != WIRE_OK || hdr.camId < 1 || hdr.camId > 3) {
+        digestsRejected++;
+        return;
+    }
+    digestsReceived++;
+    int cid = hdr.camId;
+    camWsClient[cid] = clientId;
+
+    // The whole digest's state changes in one hold
+    int threat[32];
+    int alerts = 0;
+    if (xSemaphoreTake(stateMutex, portMAX_DELAY)) {
+        sys.camHeartbeats[cid] = millis();
+        for (int i = 0; i < count; i++) {
+            const WireRecord &r = records[i];
+            WireAlert alert;
+            if (r.type == WIRE_ALERT && wireReadAlert(r, alert)) threat[alerts++] = applyCamAlert(cid);
+            else if (r.type == WIRE_TRACK && wireReadAlert(r, alert)) touchCamSector(cid);
+        }
+        xSemaphoreGive(stateMutex);
+    }
+
+    int logged = 0;
+    for (int i = 0; i < count; i++) {
+        const WireRecord &r = records[i];
+        WireAlert alert;
+        WireClip clip;
+        WireBurstAck ack;
+        if (r.type == WIRE_ALERT && wireReadAlert(r, alert)) {
+            if (logged < alerts) logCamAlert(SECTOR_NAMES[cid], "HUMAN_TARGET", alert.trackId, threat[logged++]);
+        } else if (r.type == WIRE_CLIP && wireRead(r, clip)) {
+            addGalleryClip(cid, "http://" + camIp.toString() + "/clip?id=" + String(clip.clipId));
+        } else if (r.type == WIRE_BURST_ACK && wireRead(r, ack)) {
+            noteBurstAck(cid, ack);
+        }
+        // Heartbeat and stats records also arrive over ESP-NOW, which forwards them
+    }
+    if (alerts) {
+        broadcastState();
+        pulseBuzzer(3000, 100);
+    }
+}
+
 // ==========================================================
 // 📡 COMMAND KERNEL & NETWORK
 // ==========================================================
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+    if(type == WS_EVT_CONNECT) {
+        sendStateSnapshot(client);
+        return;
+    }
     if(type == WS_EVT_DATA) {
         AwsFrameInfo *info = (AwsFrameInfo*)arg;
+        if(info->final && info->index == 0 && info->len == len && info->opcode == WS_BINARY) {
+            handleCamDigest(data, len, client->remoteIP(), client->id());
+            return;
+        }
         if(info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
             StaticJsonDocument<512> doc;
             deserializeJson(doc, data);
@@ -417,21 +992,16 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
                 String c = doc["command"];
                 if(c == "ARM") { sys.armed = true; playLocked(); addLog("REMOTE_LOCK"); }
                 if(c == "DISARM") { sys.armed = false; playUnlocked(); addLog("REMOTE_UNLOCK"); }
+                if(c == "STATE_SNAPSHOT") sendStateSnapshot(client);
+                else broadcastState();
             }
             
             if(doc.containsKey("event") && doc["event"] == "alert") {
                 int cid = doc["cam_id"] | 0;
-                String type = doc["type"] | "MOTION";
-                String sector = doc["sector"] | "UNKNOWN";
-                
-                sys.threatLevel += 20;
-                if (cid >= 1 && cid <= 3) {
-                    sys.camHeartbeats[cid] = millis();
-                    sys.lastAlertTime[cid] = millis();
-                }
-                
-                addLog("[SEC_" + sector + "] - " + type + " | LVL: " + String(sys.threatLevel));
-                pulseBuzzer(3000, 100);
+                registerCamAlert(cid, doc["sector"] | "UNKNOWN", doc["type"] | "MOTION", doc["track"] | 0);
+                if (doc.containsKey("clip")) addGalleryClip(cid, doc["clip"].as<String>());
+            } else if (doc.containsKey("event") && doc["event"] == "track") {
+                refreshCamTrack(doc["cam_id"] | 0);
             }
         }
     }
@@ -444,6 +1014,8 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
 void setup() {
     WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
     Serial.begin(115200);
+    publishMutex = xSemaphoreCreateMutex();
+    stateMutex = xSemaphoreCreateMutex();   // Before any handler or task can touch `sys`
 
     // IO SETUP
     pinMode(PIN_RED_LED, OUTPUT); pinMode(PIN_YELLOW_LED, OUTPUT); pinMode(PIN_GREEN_LED, OUTPUT);
@@ -463,7 +1035,10 @@ void setup() {
     // (Removed redundant multi-sector breach detection already in Intel Task)
     
     // STORAGE
-    if(FFat.begin(true)) sys.storageReady = true;
+    if(FFat.begin(true)) {
+        sys.storageReady = eventStoreBegin();
+        if (sys.storageReady) xTaskCreatePinnedToCore(EventFlushTask, "EVFLUSH", 4096, NULL, 1, &Event_Task_Handle, 1);
+    }
 
     // WIFI CONFIGURATION - Forced to 192.168.4.1 for Dashboard Unity
     WiFi.mode(WIFI_AP);
@@ -491,18 +1066,61 @@ void setup() {
         addLog("ESP_NOW_INIT_FAILED");
     } else {
         esp_now_register_recv_cb(OnDataRecv);
+        esp_now_peer_info_t peerInfo = {};
+        memcpy(peerInfo.peer_addr, BROADCAST_MAC, 6);
+        peerInfo.channel = 1;
+        peerInfo.ifidx = WIFI_IF_AP;
+        peerInfo.encrypt = false;
+        esp_now_add_peer(&peerInfo);   // Burst commands
         addLog("ESP_NOW_READY");
     }
 
     // SERVER
     server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request){
-        StaticJsonDocument<512> doc;
+        StaticJsonDocument<1024> doc;
         doc["armed"] = sys.armed;
         doc["threat"] = sys.threatLevel;
         doc["prox"] = sys.proximity;
         doc["temp"] = sys.coreTemp;
-        doc["log"] = sys.lastEvent;
+        doc["log"] = lastEvent();
         doc["version"] = SYS_VERSION;
+        doc["log_pending"] = eventStore.head - eventStore.tail;
+        doc["log_dropped"] = eventStore.dropped;
+        doc["log_commits"] = eventStore.commits;
+        doc["log_seq"] = eventStore.flushedSeq;
+        doc["log_segments"] = eventStore.count;
+        doc["log_clock"] = eventClock();
+        doc["state_version"] = published.version;
+        doc["state_deltas"] = published.deltas;
+        doc["state_snapshots"] = published.snapshots;
+        uint32_t espnowFrames = 0, espnowLost = 0, espnowRestarts = 0;
+        for (int i = 1; i <= 3; i++) {
+            espnowFrames += espnowLinks[i].frames;
+            espnowLost += espnowLinks[i].lost;
+            espnowRestarts += espnowLinks[i].restarts;
+        }
+        doc["espnow_frames"] = espnowFrames;
+        doc["espnow_lost"] = espnowLost;
+        doc["espnow_restarts"] = espnowRestarts;
+        doc["espnow_rejected"] = espnowRejected;
+        doc["espnow_ring_drops"] = espnowRing.drops;
+        doc["espnow_ring_high_water"] = espnowRing.highWater;
+        doc["espnow_batches"] = espnowRing.batches;
+        // Share of full-rate detection across online cameras (offline ones count as zero)
+        int coverage = 0;
+        for (int i = 1; i <= 3; i++) {
+            if (millis() - sys.camHeartbeats[i] < 10000) coverage += sys.camCoverage[i];
+        }
+        doc["coverage"] = coverage / 3;
+        JsonArray throttle = doc.createNestedArray("cam_throttle");
+        for (int i = 1; i <= 3; i++) throttle.add(sys.camThrottle[i]);
+        doc["range_pings"] = ranger.pings;
+        doc["range_echoes"] = ranger.echoes;
+        doc["bursts"] = burst.sent;
+        doc["burst_worst_ms"] = burst.worstMs;
+        doc["burst_over_budget"] = burst.overBudget;
+        JsonArray burstMs = doc.createNestedArray("burst_latency_ms");
+        for (int i = 1; i <= 3; i++) burstMs.add(burst.latencyMs[i]);
         
         String out; serializeJson(doc, out);
         request->send(200, "application/json", out);
@@ -514,19 +1132,32 @@ void setup() {
             sys.armed = (state == "1");
             if (sys.armed) playLocked(); else playUnlocked();
             addLog(sys.armed ? "REMOTE_ARMED" : "REMOTE_DISARMED");
+            broadcastState();
             request->send(200, "application/json", "{\"status\":\"ok\"}");
         } else {
             request->send(400, "application/json", "{\"error\":\"missing state\"}");
         }
     });
 
-    server.on("/api/logs", HTTP_GET, [](AsyncWebServerRequest *req){ req->send(FFat, "/pyramid.log", "text/plain"); });
+    server.on("/api/logs", HTTP_GET, eventQueryService);
     
     // Stub WiFi & Gallery Endpoints for Dashboard Compatibility
     server.on("/wifi/status", HTTP_GET, [](AsyncWebServerRequest *r){ r->send(200, "application/json", "{\"mode\":\"ap\"}"); });
     server.on("/wifi/scan", HTTP_POST, [](AsyncWebServerRequest *r){ r->send(200, "application/json", "[]"); });
     server.on("/wifi/config", HTTP_POST, [](AsyncWebServerRequest *r){ r->send(200, "application/json", "{\"status\":\"ok\"}"); });
-    server.on("/gallery.json", HTTP_GET, [](AsyncWebServerRequest *r){ r->send(200, "application/json", "[]"); });
+    server.on("/gallery.json", HTTP_GET, [](AsyncWebServerRequest *r){
+        DynamicJsonDocument doc(2048);
+        JsonArray clips = doc.to<JsonArray>();
+        for (int n = 0; n < galleryCount; n++) {
+            GalleryClip &g = gallery[(galleryHead - 1 - n + GALLERY_SLOTS) % GALLERY_SLOTS];
+            JsonObject entry = clips.createNestedObject();
+            entry["cam"] = g.cid;
+            entry["ts"] = g.ts;
+            entry["url"] = g.url;
+        }
+        String out; serializeJson(doc, out);
+        r->send(200, "application/json", out);
+    });
     
     // Enable CORS for all responses
     DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
@@ -538,8 +1169,13 @@ void setup() {
     server.begin();
 
     // DUAL-CORE LAUNCH
-    stateMutex = xSemaphoreCreateMutex();
     xTaskCreatePinnedToCore(IntelligenceTask, "INTEL", 12000, NULL, 1, NULL, 0);
+    xTaskCreatePinnedToCore(EspNowIngestTask, "INGEST", 6144, NULL, 2, &Ingest_Task_Handle, 0);
+    initRanging();
+    // Above the intelligence loop so a PIR edge never waits behind its sensor scan
+    xTaskCreatePinnedToCore(BurstTask, "BURST", 4096, NULL, 3, &Burst_Task_Handle, 0);
+    attachInterrupt(digitalPinToInterrupt(PIN_PIR1), onPirEdge, RISING);
+    attachInterrupt(digitalPinToInterrupt(PIN_PIR2), onPirEdge, RISING);
     
     // UI Task on Core 1
     xTaskCreatePinnedToCore([](void*p){ while(1){
@@ -549,6 +1185,7 @@ void setup() {
         if(digitalRead(PIN_BTN_ARM) == LOW) {
             sys.armed = !sys.armed;
             if(sys.armed) playLocked(); else playUnlocked();
+            broadcastState();
             delay(500);
         }
 
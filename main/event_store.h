@@ -0,0 +1,524 @@
+/**
+ * 🏔️ PYRAMID SENTINEL PRO - HUB EVENT STORE
+ *
+ * Shared by the Neuro-Core and the Brain hub. Events are compact binary
+ * records (EventHeader + message) appended to segment files under EVENT_DIR,
+ * each named after the sequence number of its first record in hex. Every
+ * EVENT_INDEX_STRIDE bytes a record also gets a sparse index entry
+ * (seq, time, offset) in the segment's .idx sidecar, so a query seeks to
+ * within a stride of where it starts instead of scanning. Once there are
+ * EVENT_MAX_SEGMENTS the oldest segment is deleted.
+ *
+ * Writers only copy into a RAM ring (eventAppend); EventFlushTask
+ * group-commits it and echoes each committed event to Serial. Sequence numbers are global and survive reboots. There
+ * is no RTC, so event time is a log clock in ms that resumes from the last
+ * stored event after a reboot (time spent powered off is not counted).
+ *
+ * GET /api/logs?cursor=&since=&until=&limit=&level=&format=text|json
+ *   cursor  resume at this seq (the "next" of the previous page)
+ *   since / until  log clock window in ms
+ *   limit   events per page, capped at EVENT_QUERY_LIMIT
+ *   level   lowest level returned, by name or number
+ * Without cursor or since the page is the newest `limit` events. Pages are
+ * rendered while they stream, and end with the cursor to resume from.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <FFat.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include <memory>
+
+#define EVENT_DIR               "/ev"
+#define EVENT_SEGMENT_BYTES     (64 * 1024)
+#define EVENT_MAX_SEGMENTS      12      // ~768 KB of the ffat partition
+#define EVENT_SEGMENT_SLOTS     (EVENT_MAX_SEGMENTS + 2)  // Room to roll while a query holds the oldest
+#define EVENT_INDEX_STRIDE      2048    // Segment bytes per sparse index entry
+#define EVENT_RING_BYTES        8192    // Power of two
+#define EVENT_MSG_MAX           160
+#define EVENT_COMMIT_BYTES      2048
+#define EVENT_COMMIT_MS         2000
+#define EVENT_QUERY_LIMIT       500     // Most events one page returns
+#define EVENT_QUERY_DEFAULT     100
+#define EVENT_SCAN_STEP         64      // Records read per response callback before yielding
+#define EVENT_MAGIC             0xE5
+
+enum EventLevel : uint8_t { EV_DEBUG, EV_INFO, EV_WARN, EV_ALERT };
+const char * const EVENT_LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ALERT"};
+
+struct __attribute__((packed)) EventHeader {
+    uint8_t magic;
+    uint8_t level;
+    uint8_t len;                // Message bytes that follow, no terminator
+    uint32_t seq;
+    uint32_t tsMs;              // Log clock
+};
+
+struct __attribute__((packed)) EventIndexEntry {
+    uint32_t seq;
+    uint32_t tsMs;
+    uint32_t offset;            // Of that record in the segment
+};
+
+struct EventSegment {
+    uint32_t firstSeq;
+    uint32_t firstTs;
+    uint32_t bytes;
+};
+
+struct EventStore {
+    EventSegment segments[EVENT_SEGMENT_SLOTS];  // Oldest first
+    int count = 0;
+    uint32_t nextSeq = 1;       // Next seq handed out by eventAppend
+    uint32_t flushedSeq = 1;    // Everything below is on flash
+    uint32_t clockBase = 0;     // Log clock = clockBase + millis()
+    uint32_t lastIndexed = 0;   // Offset of the active segment's last index entry
+    bool ready = false;
+    bool echo = false;          // Serial copy of each committed event (off while importing)
+    std::atomic<uint32_t> readers{0};  // Open queries; pruning waits for zero
+    uint8_t ring[EVENT_RING_BYTES];    // Encoded records waiting for EventFlushTask
+    uint32_t head = 0;          // Monotonic byte counts; head - tail bytes are pending
+    uint32_t tail = 0;
+    uint32_t dropped = 0;       // Events lost to a full ring
+    uint32_t commits = 0;
+    uint32_t writeErrors = 0;
+    uint32_t queries = 0;
+} eventStore;
+
+portMUX_TYPE eventMux = portMUX_INITIALIZER_UNLOCKED;  // Ring counters and the segment table
+TaskHandle_t Event_Task_Handle = NULL;
+
+uint32_t eventClock() {
+    return eventStore.clockBase + millis();
+}
+
+String eventPath(uint32_t firstSeq, const char *ext) {
+    char path[32];
+    snprintf(path, sizeof(path), EVENT_DIR "/%08x.%s", (unsigned) firstSeq, ext);
+    return String(path);
+}
+
+void eventRingCopy(uint32_t at, void *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) ((uint8_t *) dst)[i] = eventStore.ring[(at + i) & (EVENT_RING_BYTES - 1)];
+}
+
+// Read the record at the file's position. False at the end of the file and
+// at a torn record, which only a crash or a failed write leaves behind.
+bool readEvent(File &f, EventHeader &h, char *msg) {
+    if (f.read((uint8_t *) &h, sizeof(h)) != sizeof(h)) return false;
+    if (h.magic != EVENT_MAGIC || h.len > EVENT_MSG_MAX) return false;
+    if (f.read((uint8_t *) msg, h.len) != h.len) return false;
+    msg[h.len] = 0;
+    return true;
+}
+
+// Offset of the last indexed record at or before key (a seq, or a log clock
+// time with byTime). The first record of a segment is always indexed.
+uint32_t eventIndexSeek(uint32_t firstSeq, uint32_t key, bool byTime, uint32_t *entries = nullptr) {
+    EventIndexEntry idx[EVENT_SEGMENT_BYTES / EVENT_INDEX_STRIDE + 2];
+    File f = FFat.open(eventPath(firstSeq, "idx"), FILE_READ);
+    if (!f) return 0;
+    size_t n = f.read((uint8_t *) idx, sizeof(idx)) / sizeof(EventIndexEntry);
+    f.close();
+    if (entries) *entries = n;
+    uint32_t offset = 0;
+    for (size_t i = 0; i < n && (byTime ? idx[i].tsMs : idx[i].seq) <= key; i++) offset = idx[i].offset;
+    return offset;
+}
+
+// Copy an event into the ring. Never touches flash and never blocks; a full
+// ring drops the event (counted). Alerts are committed right away.
+void eventAppend(uint8_t level, const char *msg, size_t len) {
+    if (!eventStore.ready) return;
+    len = min(len, (size_t) EVENT_MSG_MAX);
+    EventHeader h = {EVENT_MAGIC, level, (uint8_t) len, 0, 0};
+    size_t total = sizeof(h) + len;
+    bool wake = false;
+    portENTER_CRITICAL(&eventMux);
+    uint32_t pending = eventStore.head - eventStore.tail;
+    if (pending + total <= EVENT_RING_BYTES) {
+        h.seq = eventStore.nextSeq++;
+        h.tsMs = eventClock();
+        for (size_t i = 0; i < total; i++) {
+            uint8_t b = i < sizeof(h) ? ((uint8_t *) &h)[i] : (uint8_t) msg[i - sizeof(h)];
+            eventStore.ring[(eventStore.head + i) & (EVENT_RING_BYTES - 1)] = b;
+        }
+        eventStore.head += total;
+        wake = level >= EV_ALERT || (pending < EVENT_COMMIT_BYTES && pending + total >= EVENT_COMMIT_BYTES);
+    } else {
+        eventStore.dropped++;
+    }
+    portEXIT_CRITICAL(&eventMux);
+    if (wake && Event_Task_Handle) xTaskNotifyGive(Event_Task_Handle);
+}
+
+void dropOldestEventSegment() {
+    uint32_t firstSeq = eventStore.segments[0].firstSeq;
+    portENTER_CRITICAL(&eventMux);
+    eventStore.count--;
+    memmove(eventStore.segments, eventStore.segments + 1, eventStore.count * sizeof(EventSegment));
+    portEXIT_CRITICAL(&eventMux);
+    FFat.remove(eventPath(firstSeq, "seg"));
+    FFat.remove(eventPath(firstSeq, "idx"));
+}
+
+// Start a new segment at h. Old segments are only deleted while no query
+// has one open; false if the table is full and one still is.
+bool rollEventSegment(const EventHeader &h) {
+    while (eventStore.count >= EVENT_MAX_SEGMENTS && eventStore.readers.load() == 0) dropOldestEventSegment();
+    if (eventStore.count >= EVENT_SEGMENT_SLOTS) return false;
+    portENTER_CRITICAL(&eventMux);
+    eventStore.segments[eventStore.count++] = {h.seq, h.tsMs, 0};
+    portEXIT_CRITICAL(&eventMux);
+    eventStore.lastIndexed = 0;
+    return true;
+}
+
+// Write everything pending as one batch, with one open/close per segment
+// touched. Ring bytes between tail and head never change until tail moves,
+// so they are read without the lock. A failed write retires the segment, so
+// later records never land behind a torn one.
+void commitEvents() {
+    static uint8_t rec[sizeof(EventHeader) + EVENT_MSG_MAX];
+    portENTER_CRITICAL(&eventMux);
+    uint32_t tail = eventStore.tail;
+    uint32_t pending = eventStore.head - tail;
+    uint32_t flushed = eventStore.flushedSeq;
+    portEXIT_CRITICAL(&eventMux);
+    if (!pending) return;
+
+    File seg, idx;
+    while (pending) {
+        EventHeader h;
+        eventRingCopy(tail, &h, sizeof(h));
+        size_t total = sizeof(h) + h.len;
+        if (!eventStore.count || eventStore.segments[eventStore.count - 1].bytes + total > EVENT_SEGMENT_BYTES) {
+            if (seg) seg.close();
+            if (idx) idx.close();
+            if (!rollEventSegment(h)) break;
+        }
+        EventSegment &s = eventStore.segments[eventStore.count - 1];
+        if (!seg) {
+            seg = FFat.open(eventPath(s.firstSeq, "seg"), FILE_APPEND);
+            idx = FFat.open(eventPath(s.firstSeq, "idx"), FILE_APPEND);
+            if (!seg || !idx) {
+                eventStore.writeErrors++;
+                break;
+            }
+        }
+        eventRingCopy(tail, rec, total);
+        if (seg.write(rec, total) != total) {
+            eventStore.writeErrors++;
+            s.bytes = EVENT_SEGMENT_BYTES;
+            break;
+        }
+        if (eventStore.echo) Serial.printf("[SENTINEL] %.*s\n", (int) h.len, (const char *) rec + sizeof(h));
+        if (s.bytes == 0 || s.bytes - eventStore.lastIndexed >= EVENT_INDEX_STRIDE) {
+            EventIndexEntry e = {h.seq, h.tsMs, s.bytes};
+            idx.write((uint8_t *) &e, sizeof(e));
+            eventStore.lastIndexed = s.bytes;
+        }
+        s.bytes += total;
+        flushed = h.seq + 1;
+        tail += total;
+        pending -= total;
+    }
+    if (seg) seg.close();
+    if (idx) idx.close();
+    portENTER_CRITICAL(&eventMux);
+    eventStore.tail = tail;
+    eventStore.flushedSeq = flushed;
+    portEXIT_CRITICAL(&eventMux);
+    eventStore.commits++;
+}
+
+void EventFlushTask(void * p) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, EVENT_COMMIT_MS / portTICK_PERIOD_MS);
+        commitEvents();
+    }
+}
+
+// Text log from before the event store. Each line becomes an INFO event
+// stamped at import time; its "[millis]" prefix stays in the message, since
+// those uptimes are from earlier boots. The file goes once it is imported.
+void importLegacyEventLog(const char *path) {
+    if (!FFat.exists(path)) return;
+    File f = FFat.open(path, FILE_READ);
+    if (!f) return;
+    char line[EVENT_MSG_MAX];
+    int lines = 0;
+    while (f.available()) {
+        size_t n = f.readBytesUntil('\n', line, sizeof(line));
+        if (n == sizeof(line)) while (f.available() && f.read() != '\n') {}
+        if (n && line[n - 1] == '\r') n--;
+        if (!n) continue;
+        eventAppend(EV_INFO, line, n);
+        // EventFlushTask is not running yet; commit before the ring can fill
+        if (++lines % (EVENT_RING_BYTES / (sizeof(EventHeader) + EVENT_MSG_MAX)) == 0) commitEvents();
+    }
+    f.close();
+    commitEvents();
+    FFat.remove(path);
+}
+
+// Rebuild the segment table from EVENT_DIR and resume the seq and the log
+// clock after the last intact record. A torn tail retires its segment.
+bool eventStoreBegin() {
+    if (!FFat.exists(EVENT_DIR) && !FFat.mkdir(EVENT_DIR)) return false;
+    File dir = FFat.open(EVENT_DIR, FILE_READ);
+    if (!dir || !dir.isDirectory()) return false;
+
+    EventSegment *segs = eventStore.segments;
+    int count = 0;
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        const char *name = strrchr(f.name(), '/');
+        name = name ? name + 1 : f.name();
+        char *end;
+        uint32_t firstSeq = strtoul(name, &end, 16);
+        if (end == name || strcmp(end, ".seg") != 0) continue;
+        EventHeader h;
+        char msg[EVENT_MSG_MAX + 1];
+        EventSegment s = {firstSeq, 0, (uint32_t) f.size()};
+        bool readable = readEvent(f, h, msg);
+        f.close();
+        if (readable) s.firstTs = h.tsMs;
+        if (!readable || (count == EVENT_MAX_SEGMENTS && firstSeq < segs[0].firstSeq)) {
+            FFat.remove(eventPath(firstSeq, "seg"));
+            FFat.remove(eventPath(firstSeq, "idx"));
+            continue;
+        }
+        if (count == EVENT_MAX_SEGMENTS) {
+            FFat.remove(eventPath(segs[0].firstSeq, "seg"));
+            FFat.remove(eventPath(segs[0].firstSeq, "idx"));
+            memmove(segs, segs + 1, --count * sizeof(EventSegment));
+        }
+        int i = count++;
+        for (; i > 0 && segs[i - 1].firstSeq > firstSeq; i--) segs[i] = segs[i - 1];
+        segs[i] = s;
+    }
+    dir.close();
+    eventStore.count = count;
+
+    if (count) {
+        EventSegment &last = segs[count - 1];
+        uint32_t entries = 0;
+        uint32_t offset = eventIndexSeek(last.firstSeq, UINT32_MAX, false, &entries);
+        File f = FFat.open(eventPath(last.firstSeq, "seg"), FILE_READ);
+        EventHeader h, good = {};
+        char msg[EVENT_MSG_MAX + 1];
+        uint32_t end = offset;
+        f.seek(offset);
+        while (readEvent(f, h, msg)) {
+            good = h;
+            end += sizeof(h) + h.len;
+        }
+        f.close();
+        File idx = FFat.open(eventPath(last.firstSeq, "idx"), FILE_READ);
+        bool idxTorn = !idx || idx.size() != entries * sizeof(EventIndexEntry);
+        if (idx) idx.close();
+        if (end < last.bytes || idxTorn) last.bytes = EVENT_SEGMENT_BYTES;
+        eventStore.lastIndexed = offset;
+        eventStore.nextSeq = eventStore.flushedSeq = good.seq + 1;
+        eventStore.clockBase = good.tsMs + 1 - millis();
+    }
+    eventStore.ready = true;
+    importLegacyEventLog("/pyramid.1.log");     // Older half first
+    importLegacyEventLog("/pyramid.log");
+    eventStore.echo = true;
+    return true;
+}
+
+// ==========================================================
+// 🔎 EVENT QUERY (PAGINATED /api/logs)
+// ==========================================================
+struct EventQuery {
+    uint32_t fromSeq = 0;       // 0 = start from `since`
+    uint32_t since = 0;
+    uint32_t until = UINT32_MAX;
+    uint32_t limit = EVENT_QUERY_DEFAULT;
+    uint8_t minLevel = EV_DEBUG;
+    bool json = false;
+    bool opened = false;
+    bool more = false;          // Stopped at the limit, not at the end of the window
+    File seg;
+    uint32_t segSeq = 0;        // firstSeq of the open segment
+    uint32_t sent = 0;
+    uint32_t next = 0;          // Seq of the first record not yet examined
+    int budget = 0;             // Records left to read in this callback
+    enum { Q_HEAD, Q_BODY, Q_TAIL, Q_DONE } phase = Q_HEAD;
+    char out[512];
+    size_t outLen = 0;
+    size_t outPos = 0;
+
+    EventQuery() { eventStore.readers++; }
+    ~EventQuery() {
+        if (seg) seg.close();
+        eventStore.readers--;
+    }
+};
+
+// Open the segment holding the query start, or the one after the open one.
+bool eventQueryOpenNext(EventQuery &q) {
+    int found = -1;
+    uint32_t firstSeq = 0;
+    portENTER_CRITICAL(&eventMux);
+    for (int i = 0; i < eventStore.count; i++) {
+        EventSegment &s = eventStore.segments[i];
+        if (q.opened) {
+            if (s.firstSeq > q.segSeq) { found = i; break; }
+        } else if (q.fromSeq ? s.firstSeq <= q.fromSeq : s.firstTs <= q.since) {
+            found = i;
+        } else if (found < 0) {
+            found = i;
+            break;
+        }
+    }
+    if (found >= 0) firstSeq = eventStore.segments[found].firstSeq;
+    portEXIT_CRITICAL(&eventMux);
+    if (found < 0) return false;
+
+    uint32_t offset = q.opened ? 0 : q.fromSeq ? eventIndexSeek(firstSeq, q.fromSeq, false) : eventIndexSeek(firstSeq, q.since, true);
+    q.opened = true;
+    q.segSeq = firstSeq;
+    q.seg = FFat.open(eventPath(firstSeq, "seg"), FILE_READ);
+    if (q.seg) q.seg.seek(offset);
+    return true;
+}
+
+enum EventStep { EV_STEP_FOUND, EV_STEP_PAUSE, EV_STEP_END };
+
+// Next record in the window that passes the level filter.
+EventStep eventQueryNext(EventQuery &q, EventHeader &h, char *msg) {
+    while (q.sent < q.limit) {
+        if (q.budget-- <= 0) return EV_STEP_PAUSE;
+        if (!q.seg && !eventQueryOpenNext(q)) return EV_STEP_END;
+        if (!q.seg || !readEvent(q.seg, h, msg)) {
+            if (q.seg) q.seg.close();
+            continue;
+        }
+        if (h.seq < q.fromSeq || h.tsMs < q.since) continue;
+        if (h.tsMs > q.until) {
+            q.next = h.seq;
+            return EV_STEP_END;
+        }
+        q.next = h.seq + 1;
+        if (h.level < q.minLevel) continue;
+        q.sent++;
+        return EV_STEP_FOUND;
+    }
+    q.more = true;
+    return EV_STEP_END;
+}
+
+// Render the next piece of the page into q.out.
+EventStep eventQueryRender(EventQuery &q) {
+    q.outPos = 0;
+    q.outLen = 0;
+    if (q.phase == EventQuery::Q_HEAD) {
+        if (q.json) q.outLen = strlcpy(q.out, "{\"events\":[", sizeof(q.out));
+        q.phase = EventQuery::Q_BODY;
+        return EV_STEP_FOUND;
+    }
+    if (q.phase == EventQuery::Q_BODY) {
+        EventHeader h;
+        char msg[EVENT_MSG_MAX + 1];
+        EventStep step = eventQueryNext(q, h, msg);
+        if (step == EV_STEP_PAUSE) return step;
+        if (step == EV_STEP_FOUND) {
+            const char *level = EVENT_LEVEL_NAMES[min(h.level, (uint8_t) EV_ALERT)];
+            if (q.json) {
+                StaticJsonDocument<384> doc;
+                doc["seq"] = h.seq;
+                doc["ts"] = h.tsMs;
+                doc["level"] = level;
+                doc["msg"] = (const char *) msg;
+                if (q.sent > 1) q.out[q.outLen++] = ',';
+                // Escapes can grow a message up to 6x; shorten it (on a UTF-8
+                // boundary) rather than send a truncated record
+                size_t room = sizeof(q.out) - q.outLen - 1;
+                size_t len = strlen(msg);
+                for (size_t need = measureJson(doc); need > room && len; need = measureJson(doc)) {
+                    len -= min((need - room + 5) / 6, len);
+                    while (len && (msg[len] & 0xC0) == 0x80) len--;
+                    msg[len] = 0;
+                }
+                q.outLen += serializeJson(doc, q.out + q.outLen, sizeof(q.out) - q.outLen);
+            } else {
+                q.outLen = snprintf(q.out, sizeof(q.out), "[%lu] %s %s\n", (unsigned long) h.tsMs, level, msg);
+            }
+            return EV_STEP_FOUND;
+        }
+        q.phase = EventQuery::Q_TAIL;
+    }
+    if (q.phase == EventQuery::Q_TAIL) {
+        if (q.json) {
+            q.outLen = snprintf(q.out, sizeof(q.out), "],\"next\":%lu,\"more\":%s,\"clock\":%lu}",
+                                (unsigned long) q.next, q.more ? "true" : "false", (unsigned long) eventClock());
+        } else {
+            q.outLen = snprintf(q.out, sizeof(q.out), "# next=%lu more=%d clock=%lu\n",
+                                (unsigned long) q.next, q.more, (unsigned long) eventClock());
+        }
+        q.phase = EventQuery::Q_DONE;
+        return EV_STEP_FOUND;
+    }
+    return EV_STEP_END;
+}
+
+size_t eventQueryFill(EventQuery &q, uint8_t *buffer, size_t maxLen) {
+    size_t written = 0;
+    q.budget = EVENT_SCAN_STEP;
+    while (written < maxLen) {
+        if (q.outPos == q.outLen) {
+            EventStep step = eventQueryRender(q);
+            if (step == EV_STEP_END) break;
+            if (step == EV_STEP_PAUSE) return written ? written : RESPONSE_TRY_AGAIN;
+        }
+        size_t take = min(maxLen - written, q.outLen - q.outPos);
+        memcpy(buffer + written, q.out + q.outPos, take);
+        q.outPos += take;
+        written += take;
+    }
+    return written;
+}
+
+void eventQueryService(AsyncWebServerRequest *request) {
+    auto param = [request](const char *name, uint32_t fallback) -> uint32_t {
+        return request->hasParam(name) ? strtoul(request->getParam(name)->value().c_str(), nullptr, 10) : fallback;
+    };
+    std::shared_ptr<EventQuery> q = std::make_shared<EventQuery>();
+    q->limit = constrain(param("limit", EVENT_QUERY_DEFAULT), (uint32_t) 1, (uint32_t) EVENT_QUERY_LIMIT);
+    q->since = param("since", 0);
+    q->until = param("until", UINT32_MAX);
+    q->fromSeq = param("cursor", 0);
+    if (!q->fromSeq && !request->hasParam("since")) {
+        portENTER_CRITICAL(&eventMux);
+        uint32_t oldest = eventStore.count ? eventStore.segments[0].firstSeq : eventStore.flushedSeq;
+        uint32_t head = eventStore.flushedSeq;
+        portEXIT_CRITICAL(&eventMux);
+        q->fromSeq = head - oldest > q->limit ? head - q->limit : max(oldest, (uint32_t) 1);
+    }
+    portENTER_CRITICAL(&eventMux);
+    q->next = q->fromSeq ? q->fromSeq : eventStore.flushedSeq;
+    portEXIT_CRITICAL(&eventMux);
+    if (request->hasParam("level")) {
+        String level = request->getParam("level")->value();
+        long n = isDigit(level[0]) ? level.toInt() : EV_DEBUG;
+        q->minLevel = n > EV_ALERT ? EV_ALERT : n;     // Past ALERT still means alerts only
+        for (int i = 0; i <= EV_ALERT; i++) {
+            if (level.equalsIgnoreCase(EVENT_LEVEL_NAMES[i])) q->minLevel = i;
+        }
+    }
+    q->json = request->hasParam("format") && request->getParam("format")->value() == "json";
+    eventStore.queries++;
+    if (Event_Task_Handle) xTaskNotifyGive(Event_Task_Handle);  // Pending events are there for the next page
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse(q->json ? "application/json" : "text/plain",
+        [q](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return eventQueryFill(*q, buffer, maxLen);
+        });
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(response);
+}
@@ -0,0 +1,747 @@
+/**
+ * 🏔️ PYRAMID SENTINEL PRO - NEURAL PIPELINE
+ *
+ * Gate, decode, detect, track and alert-decision stages shared by the camera
+ * firmware and the offline replay harness (tools/replay). Everything here only
+ * needs the esp32-camera / esp-face types, so it builds on the ESP32 and on Linux.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "img_converters.h"
+#include "esp_jpg_decode.h"
+#include "fd_forward.h"
+
+// Motion-mask ROI detection: run the sensor at ROI_FRAMESIZE and give MTMN
+// native-resolution crops of the moving sectors instead of the whole frame
+#ifndef ROI_DETECTION
+#define ROI_DETECTION   0
+#endif
+#define ROI_FRAMESIZE   FRAMESIZE_VGA
+
+// Last detection frame, per stage (the capture and gate stages are timed by the caller)
+struct StageTimes {
+    uint32_t captureUs = 0;
+    uint32_t gateUs = 0;
+    uint32_t decodeUs = 0;
+    uint32_t detectUs = 0;
+} stageTimes;
+
+// ==========================================================
+// 🧮 IMAGE MATRIX POOL (BOOT-TIME PSRAM)
+// ==========================================================
+// RGB888 matrices for the neural path are carved out of PSRAM once at boot,
+// sized from the configured frame_size, and borrowed per frame. A miss falls
+// back to dl_matrix3du_alloc and is counted so the hot loop can be audited.
+// The pool only covers the decode target: face_detect() and get_face_id()
+// still allocate their own scratch buffers inside esp-face on every call,
+// so a frame with no pool misses is not a frame without heap traffic.
+#if ROI_DETECTION
+#define IMAGE_POOL_SLOTS 1      // Only allocated if the ROI detector could not start
+#else
+#define IMAGE_POOL_SLOTS 2
+#endif
+
+struct ImagePoolSlot {
+    dl_matrix3du_t matrix;
+    size_t capacity = 0;
+    bool inUse = false;
+};
+
+struct ImagePool {
+    ImagePoolSlot slots[IMAGE_POOL_SLOTS];
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t framePoolMisses = 0; // Pool misses in the last frame
+    uint32_t peakFramePoolMisses = 0;
+} imagePool;
+
+portMUX_TYPE imagePoolMux = portMUX_INITIALIZER_UNLOCKED;
+
+void initImagePool(framesize_t size) {
+    size_t bytes = (size_t)resolution[size].width * resolution[size].height * 3;
+    for (int i = 0; i < IMAGE_POOL_SLOTS; i++) {
+        ImagePoolSlot &slot = imagePool.slots[i];
+        slot.matrix.item = (uc_t *) heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!slot.matrix.item) slot.matrix.item = (uc_t *) malloc(bytes);
+        slot.capacity = slot.matrix.item ? bytes : 0;
+    }
+}
+
+dl_matrix3du_t *borrowImageMatrix(int w, int h) {
+    size_t bytes = (size_t)w * h * 3;
+    portENTER_CRITICAL(&imagePoolMux);
+    for (int i = 0; i < IMAGE_POOL_SLOTS; i++) {
+        ImagePoolSlot &slot = imagePool.slots[i];
+        if (!slot.inUse && slot.capacity >= bytes) {
+            slot.inUse = true;
+            slot.matrix.w = w;
+            slot.matrix.h = h;
+            slot.matrix.c = 3;
+            slot.matrix.n = 1;
+            slot.matrix.stride = w * 3;
+            imagePool.hits++;
+            portEXIT_CRITICAL(&imagePoolMux);
+            return &slot.matrix;
+        }
+    }
+    imagePool.misses++;
+    imagePool.framePoolMisses++;
+    portEXIT_CRITICAL(&imagePoolMux);
+    return dl_matrix3du_alloc(1, w, h, 3);
+}
+
+void returnImageMatrix(dl_matrix3du_t *m) {
+    if (!m) return;
+    portENTER_CRITICAL(&imagePoolMux);
+    for (int i = 0; i < IMAGE_POOL_SLOTS; i++) {
+        if (&imagePool.slots[i].matrix == m) {
+            imagePool.slots[i].inUse = false;
+            portEXIT_CRITICAL(&imagePoolMux);
+            return;
+        }
+    }
+    portEXIT_CRITICAL(&imagePoolMux);
+    dl_matrix3du_free(m);
+}
+
+// ==========================================================
+// 🎯 MOTION GATE (1/8-SCALE LUMA)
+// ==========================================================
+// A 1/8-scale JPEG decode only touches the DC coefficient of each 8x8 block,
+// which is enough to tell a static scene from a changing one. Raw RGB565
+// frames are averaged per 8x8 block into the same buffer instead. Frames only
+// go on to the full RGB888 decode + MTMN when some sector changed enough.
+#define GATE_GRID          4      // GATE_GRID x GATE_GRID sectors over the frame
+#define GATE_SECTOR_DELTA  10     // Mean |Δluma| in a sector that counts as motion
+#define GATE_REFRESH_MS    2000   // Force a full pass at least this often
+
+struct MotionGate {
+    uint8_t *rgb = nullptr;       // 1/8-scale RGB565 decode target
+    uint8_t *luma = nullptr;      // Previous 1/8-scale luma plane
+    int w = 0;
+    int h = 0;
+    size_t capacity = 0;          // Pixels the 1/8-scale buffers can hold
+    bool primed = false;
+    uint32_t lastPass = 0;
+    uint32_t hits = 0;            // Frames forwarded to decode + MTMN
+    uint32_t misses = 0;          // Frames rejected as static
+    uint8_t lastPeakDelta = 0;    // Largest sector delta of the last frame
+    uint32_t mask = 0;            // Sectors over GATE_SECTOR_DELTA in the last frame
+} motionGate;
+
+void initMotionGate(framesize_t size) {
+    motionGate.w = (resolution[size].width + 7) / 8;
+    motionGate.h = (resolution[size].height + 7) / 8;
+    size_t px = (size_t)motionGate.w * motionGate.h;
+    motionGate.capacity = px;
+    motionGate.rgb = (uint8_t *) heap_caps_malloc(px * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    motionGate.luma = (uint8_t *) heap_caps_calloc(px, 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+// Mean of each 8x8 block of a raw frame (every other pixel), packed like jpg2rgb565 output.
+void blockAverageRgb565(const camera_fb_t * fb, int w, int h, uint8_t * out) {
+    for (int by = 0; by < h; by++) {
+        int yEnd = min(by * 8 + 8, (int)fb->height);
+        for (int bx = 0; bx < w; bx++) {
+            int xEnd = min(bx * 8 + 8, (int)fb->width);
+            uint32_t r = 0, g = 0, b = 0, n = 0;
+            for (int y = by * 8; y < yEnd; y += 2) {
+                const uint8_t * row = fb->buf + (size_t)y * fb->width * 2;
+                for (int x = bx * 8; x < xEnd; x += 2) {
+                    uint16_t px = (row[x * 2] << 8) | row[x * 2 + 1];
+                    r += px >> 11;
+                    g += (px >> 5) & 0x3F;
+                    b += px & 0x1F;
+                    n++;
+                }
+            }
+            uint16_t px = ((r / n) << 11) | ((g / n) << 5) | (b / n);
+            out[(by * w + bx) * 2] = px >> 8;
+            out[(by * w + bx) * 2 + 1] = px & 0xFF;
+        }
+    }
+}
+
+bool motionGatePass(camera_fb_t * fb) {
+    // Anything the gate cannot judge goes straight to the detector
+    if (!motionGate.rgb || !motionGate.luma) return true;
+    bool raw = fb->format == PIXFORMAT_RGB565;
+    if (fb->format != PIXFORMAT_JPEG && !raw) return true;
+    if (raw && fb->len < (size_t)fb->width * fb->height * 2) return true;
+    int w = (fb->width + 7) / 8;
+    int h = (fb->height + 7) / 8;
+    if ((size_t)w * h > motionGate.capacity) return true;
+    if (w != motionGate.w || h != motionGate.h) {
+        // Frame size was changed by the stream controller: re-prime on this frame
+        motionGate.w = w;
+        motionGate.h = h;
+        motionGate.primed = false;
+    }
+    if (raw) blockAverageRgb565(fb, w, h, motionGate.rgb);
+    else if (!jpg2rgb565(fb->buf, fb->len, motionGate.rgb, JPG_SCALE_8X)) return true;
+
+    uint32_t delta[GATE_GRID * GATE_GRID] = {0};
+    uint32_t count[GATE_GRID * GATE_GRID] = {0};
+    for (int y = 0; y < h; y++) {
+        int row = (y * GATE_GRID / h) * GATE_GRID;
+        for (int x = 0; x < w; x++) {
+            int i = y * w + x;
+            uint16_t px = (motionGate.rgb[i * 2] << 8) | motionGate.rgb[i * 2 + 1];
+            uint8_t r = (px >> 8) & 0xF8;
+            uint8_t g = (px >> 3) & 0xFC;
+            uint8_t b = (px << 3) & 0xF8;
+            uint8_t luma = (77 * r + 150 * g + 29 * b) >> 8;
+            int sector = row + x * GATE_GRID / w;
+            delta[sector] += abs((int)luma - motionGate.luma[i]);
+            count[sector]++;
+            motionGate.luma[i] = luma;
+        }
+    }
+
+    uint8_t peak = 0;
+    uint32_t mask = 0;
+    for (int s = 0; s < GATE_GRID * GATE_GRID; s++) {
+        if (!count[s]) continue;
+        uint32_t mean = delta[s] / count[s];
+        if (mean > peak) peak = mean;
+        if (mean >= GATE_SECTOR_DELTA) mask |= 1u << s;
+    }
+    motionGate.lastPeakDelta = peak;
+    motionGate.mask = motionGate.primed ? mask : 0;
+
+    bool pass = !motionGate.primed || peak >= GATE_SECTOR_DELTA || (millis() - motionGate.lastPass > GATE_REFRESH_MS);
+    motionGate.primed = true;
+    if (pass) {
+        motionGate.hits++;
+        motionGate.lastPass = millis();
+    } else {
+        motionGate.misses++;
+    }
+    return pass;
+}
+
+// ==========================================================
+// 🔬 MOTION-MASK ROI DETECTION
+// ==========================================================
+// With ROI_DETECTION the sensor runs at ROI_FRAMESIZE and MTMN only sees
+// crops of the sectors the motion gate flagged, cut from the native frame.
+// All of a frame's crops share one QVGA-sized buffer, larger regions being
+// sampled down to fit, so MTMN never does more than one QVGA pass per frame.
+// The crops are filled straight from the JPEG decoder's output blocks, scaled
+// down in the decoder when every region is sampled down anyway, so the full
+// frame never exists as RGB888. The decoder still entropy-decodes the whole
+// bitstream, which costs more than a QVGA frame's; the saving is the full
+// frame write, its 900 KB buffer, and MTMN work bounded at the old QVGA pass.
+// Boxes are mapped back to frame pixels.
+#define ROI_CROP_W          320     // ROI buffer: the most MTMN work per frame
+#define ROI_CROP_H          240
+#define ROI_MAX_REGIONS     3       // More moving blobs than this are merged into one
+#define MAX_DETECTIONS      8
+
+struct Detection {
+    int x1, y1, x2, y2;         // Frame pixels
+    float score;
+    float landmarks[10];        // Frame pixels: eyes, nose, mouth corners as x,y pairs
+    uint8_t crop;               // 1 + the ROI crop it was found in, 0 = the whole frame
+};
+
+struct DetectionResult {
+    Detection boxes[MAX_DETECTIONS];
+    int count = 0;
+};
+
+struct RoiRect {
+    int x0, y0, x1, y1;
+};
+
+struct RoiCrop {
+    dl_matrix3du_t matrix;      // View into the crop arena, BGR888 as fmt2rgb888 writes it
+    RoiRect rect;               // Frame area it samples
+    float scale = 1.0f;         // Frame pixels per crop pixel
+};
+
+struct RoiDetector {
+    uc_t * arena = nullptr;     // ROI_CROP_W x ROI_CROP_H x 3, shared by the frame's crops
+    RoiCrop crops[ROI_MAX_REGIONS];
+    int cropCount = 0;
+    int decodeScale = 1;        // The frame's JPEG is decoded at 1/decodeScale
+    jpg_scale_t jpegScale = JPG_SCALE_NONE;
+    bool enabled = false;
+    int lastRegions = 0;
+    uint32_t lastPixels = 0;    // Pixels MTMN looked at in the last frame
+} roi;
+
+void initRoiDetector() {
+    roi.arena = (uc_t *) heap_caps_malloc(ROI_CROP_W * ROI_CROP_H * 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    for (RoiCrop &c : roi.crops) {
+        c.matrix.n = 1;
+        c.matrix.c = 3;
+    }
+    roi.enabled = roi.arena != nullptr;
+}
+
+// Group the gate's moving sectors into padded bounding boxes (4-connected blobs).
+int buildMotionRegions(int w, int h, RoiRect * regions) {
+    uint32_t mask = motionGate.mask;
+    if (!mask) {
+        // Forced refresh or unprimed gate: look at the whole frame
+        regions[0] = {0, 0, w, h};
+        return 1;
+    }
+    int count = 0;
+    uint32_t seen = 0;
+    RoiRect all = {GATE_GRID, GATE_GRID, 0, 0};
+    for (int start = 0; start < GATE_GRID * GATE_GRID; start++) {
+        if (!(mask & (1u << start)) || (seen & (1u << start))) continue;
+        int stack[GATE_GRID * GATE_GRID];
+        int top = 0;
+        stack[top++] = start;
+        seen |= 1u << start;
+        RoiRect cells = {GATE_GRID, GATE_GRID, 0, 0};
+        while (top) {
+            int s = stack[--top];
+            int sx = s % GATE_GRID, sy = s / GATE_GRID;
+            cells = {min(cells.x0, sx), min(cells.y0, sy), max(cells.x1, sx + 1), max(cells.y1, sy + 1)};
+            const int nx[4] = {sx - 1, sx + 1, sx, sx};
+            const int ny[4] = {sy, sy, sy - 1, sy + 1};
+            for (int k = 0; k < 4; k++) {
+                if (nx[k] < 0 || ny[k] < 0 || nx[k] >= GATE_GRID || ny[k] >= GATE_GRID) continue;
+                int n = ny[k] * GATE_GRID + nx[k];
+                if ((mask & (1u << n)) && !(seen & (1u << n))) {
+                    seen |= 1u << n;
+                    stack[top++] = n;
+                }
+            }
+        }
+        all = {min(all.x0, cells.x0), min(all.y0, cells.y0), max(all.x1, cells.x1), max(all.y1, cells.y1)};
+        if (count < ROI_MAX_REGIONS) regions[count] = cells;
+        count++;
+    }
+    if (count > ROI_MAX_REGIONS) {
+        regions[0] = all;
+        count = 1;
+    }
+    // Sector cells -> pixels, padded by half a sector so faces on a border are kept whole
+    int padX = w / GATE_GRID / 2, padY = h / GATE_GRID / 2;
+    for (int i = 0; i < count; i++) {
+        RoiRect &r = regions[i];
+        r = {max(0, r.x0 * w / GATE_GRID - padX), max(0, r.y0 * h / GATE_GRID - padY),
+             min(w, r.x1 * w / GATE_GRID + padX), min(h, r.y1 * h / GATE_GRID + padY)};
+    }
+    return count;
+}
+
+// Size each region's crop so that all of them together fit the arena: MTMN
+// never sees more than ROI_CROP_W x ROI_CROP_H pixels per frame, however many
+// regions moved. The JPEG is then decoded at the coarsest scale that still
+// leaves every crop a decoded pixel per sample.
+void planRoiCrops(const RoiRect * regions, int count) {
+    float area = 0;
+    for (int i = 0; i < count; i++) area += (float)(regions[i].x1 - regions[i].x0) * (regions[i].y1 - regions[i].y0);
+    float shared = max(1.0f, sqrtf(area / (ROI_CROP_W * ROI_CROP_H)));
+    float finest = 8.0f;
+    uc_t * next = roi.arena;
+    for (int i = 0; i < count; i++) {
+        RoiCrop &c = roi.crops[i];
+        int rw = regions[i].x1 - regions[i].x0, rh = regions[i].y1 - regions[i].y0;
+        c.rect = regions[i];
+        c.scale = max(shared, max((float)rw / ROI_CROP_W, (float)rh / ROI_CROP_H));
+        c.matrix.w = max(1, (int)(rw / c.scale));
+        c.matrix.h = max(1, (int)(rh / c.scale));
+        c.matrix.stride = c.matrix.w * 3;
+        c.matrix.item = next;
+        next += c.matrix.w * c.matrix.h * 3;
+        finest = min(finest, c.scale);
+    }
+    roi.cropCount = count;
+    roi.jpegScale = finest >= 8 ? JPG_SCALE_8X : finest >= 4 ? JPG_SCALE_4X : finest >= 2 ? JPG_SCALE_2X : JPG_SCALE_NONE;
+    roi.decodeScale = 1 << roi.jpegScale;
+}
+
+// Decoded-image coordinate of crop sample i, and the first sample at or past `lo`.
+int roiSample(int origin, float scale, int i) {
+    return (origin + (int)(i * scale)) / roi.decodeScale;
+}
+
+int roiFirstSample(int origin, float scale, int n, int lo) {
+    int i = max(0, (int)((lo * roi.decodeScale - origin) / scale) - 1);
+    while (i < n && roiSample(origin, scale, i) < lo) i++;
+    return i;
+}
+
+size_t roiJpegReader(void * arg, size_t index, uint8_t * buf, size_t len) {
+    camera_fb_t * fb = (camera_fb_t *) arg;
+    if (index + len > fb->len) len = fb->len - index;
+    if (buf) memcpy(buf, fb->buf + index, len);
+    return len;
+}
+
+// esp_jpg_decode hands over the frame block by block (RGB888 at 1/decodeScale);
+// only the samples that land in a crop are kept. No full frame is ever stored.
+bool roiCropWriter(void *, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t * data) {
+    if (!data) return true;     // Start / end of image
+    for (int k = 0; k < roi.cropCount; k++) {
+        RoiCrop &c = roi.crops[k];
+        for (int cy = roiFirstSample(c.rect.y0, c.scale, c.matrix.h, y); cy < c.matrix.h; cy++) {
+            int sy = roiSample(c.rect.y0, c.scale, cy);
+            if (sy >= y + h) break;
+            const uint8_t * row = data + (size_t)(sy - y) * w * 3;
+            uc_t * dst = c.matrix.item + cy * c.matrix.stride;
+            for (int cx = roiFirstSample(c.rect.x0, c.scale, c.matrix.w, x); cx < c.matrix.w; cx++) {
+                int sx = roiSample(c.rect.x0, c.scale, cx);
+                if (sx >= x + w) break;
+                const uint8_t * p = row + (sx - x) * 3;
+                uc_t * o = dst + cx * 3;
+                o[0] = p[2];
+                o[1] = p[1];
+                o[2] = p[0];
+            }
+        }
+    }
+    return true;
+}
+
+// Raw frames need no decode: the crops are sampled straight from the RGB565 buffer.
+void cropRgb565(camera_fb_t * fb) {
+    for (int k = 0; k < roi.cropCount; k++) {
+        RoiCrop &c = roi.crops[k];
+        for (int cy = 0; cy < c.matrix.h; cy++) {
+            const uint8_t * row = fb->buf + (size_t)(c.rect.y0 + (int)(cy * c.scale)) * fb->width * 2;
+            uc_t * dst = c.matrix.item + cy * c.matrix.stride;
+            for (int cx = 0; cx < c.matrix.w; cx++) {
+                const uint8_t * p = row + (c.rect.x0 + (int)(cx * c.scale)) * 2;
+                uint16_t px = (p[0] << 8) | p[1];
+                dst[cx * 3] = (px << 3) & 0xF8;
+                dst[cx * 3 + 1] = (px >> 3) & 0xFC;
+                dst[cx * 3 + 2] = (px >> 8) & 0xF8;
+            }
+        }
+    }
+}
+
+// Map MTMN boxes back into frame pixels, dropping repeats from overlapping regions.
+void mergeBoxes(box_array_t * boxes, const RoiRect &r, float scale, uint8_t crop, DetectionResult &result) {
+    for (int i = 0; i < boxes->len && result.count < MAX_DETECTIONS; i++) {
+        Detection d;
+        d.x1 = r.x0 + boxes->box[i].box_p[0] * scale;
+        d.y1 = r.y0 + boxes->box[i].box_p[1] * scale;
+        d.x2 = r.x0 + boxes->box[i].box_p[2] * scale;
+        d.y2 = r.y0 + boxes->box[i].box_p[3] * scale;
+        d.score = boxes->score ? boxes->score[i] : 0;
+        d.crop = crop;
+        for (int k = 0; k < 10; k++) {
+            float p = boxes->landmark ? boxes->landmark[i].landmark_p[k] : 0;
+            d.landmarks[k] = ((k & 1) ? r.y0 : r.x0) + p * scale;
+        }
+        bool repeat = false;
+        for (int j = 0; j < result.count && !repeat; j++) {
+            Detection &o = result.boxes[j];
+            int ix = min(d.x2, o.x2) - max(d.x1, o.x1);
+            int iy = min(d.y2, o.y2) - max(d.y1, o.y1);
+            repeat = ix > 0 && iy > 0 && ix * iy * 2 > (d.x2 - d.x1) * (d.y2 - d.y1);
+        }
+        if (!repeat) result.boxes[result.count++] = d;
+    }
+}
+
+// ==========================================================
+// 🛰️ TARGET TRACKER
+// ==========================================================
+// Detections are matched to tracks by IoU, falling back to centroid
+// distance for small or fast boxes. A track alerts once when it is
+// confirmed and then sends a throttled update while it stays in view.
+// A track the caller has identified as a known person stays tracked (so
+// it is not re-created and re-checked) but never reports.
+#define TRACK_SLOTS         6
+#define TRACK_CONFIRM_HITS  2       // Detections before a track raises its alert
+#define TRACK_MAX_MISSES    3       // Detector passes without a match before a track is dropped
+#define TRACK_MATCH_IOU     0.3f
+#define TRACK_MATCH_DIST    0.75f   // Centroid distance, as a fraction of the box width
+#define TRACK_UPDATE_MS     5000    // Minimum gap between updates for one track
+
+enum TrackIdentity : uint8_t {
+    ID_UNCHECKED,       // Nobody looked; reports as usual
+    ID_CHECKING,        // Recognition pending; reports held
+    ID_STRANGER,
+    ID_KNOWN,           // Enrolled person; never reports
+};
+
+struct Track {
+    bool used = false;
+    uint32_t id;
+    Detection box;
+    int8_t match;               // Detection index from the last pass, -1 if unmatched
+    uint8_t hits;
+    uint8_t misses;
+    TrackIdentity identity;
+    uint8_t idTries;
+    bool alerted;
+    uint32_t firstSeen;
+    uint32_t lastReport;
+};
+
+struct TargetTracker {
+    Track tracks[TRACK_SLOTS];
+    uint32_t nextId = 1;
+    uint32_t created = 0;
+    uint32_t updatesSent = 0;
+    uint32_t suppressed = 0;    // Confirmed-target frames that sent nothing
+} tracker;
+
+float boxIoU(const Detection &a, const Detection &b) {
+    int ix = min(a.x2, b.x2) - max(a.x1, b.x1);
+    int iy = min(a.y2, b.y2) - max(a.y1, b.y1);
+    if (ix <= 0 || iy <= 0) return 0;
+    float inter = (float)ix * iy;
+    return inter / ((float)(a.x2 - a.x1) * (a.y2 - a.y1) + (float)(b.x2 - b.x1) * (b.y2 - b.y1) - inter);
+}
+
+// Match score for a detection against a track; 0 means no match.
+float trackMatch(const Track &t, const Detection &d) {
+    float iou = boxIoU(t.box, d);
+    if (iou >= TRACK_MATCH_IOU) return 1.0f + iou;
+    float dx = (t.box.x1 + t.box.x2 - d.x1 - d.x2) / 2.0f;
+    float dy = (t.box.y1 + t.box.y2 - d.y1 - d.y2) / 2.0f;
+    float reach = TRACK_MATCH_DIST * max(1, t.box.x2 - t.box.x1);
+    float dist = sqrtf(dx * dx + dy * dy);
+    return dist < reach ? 1.0f - dist / reach : 0;
+}
+
+// Feed one detector pass into the tracks (greedy best-match assignment).
+void updateTracks(const DetectionResult &result) {
+    bool taken[MAX_DETECTIONS] = {false};
+    for (int i = 0; i < TRACK_SLOTS; i++) {
+        Track &t = tracker.tracks[i];
+        if (!t.used) continue;
+        int best = -1;
+        float bestScore = 0;
+        for (int d = 0; d < result.count; d++) {
+            if (taken[d]) continue;
+            float score = trackMatch(t, result.boxes[d]);
+            if (score > bestScore) { bestScore = score; best = d; }
+        }
+        if (best < 0) {
+            t.match = -1;
+            if (++t.misses > TRACK_MAX_MISSES) t.used = false;
+            continue;
+        }
+        taken[best] = true;
+        t.box = result.boxes[best];
+        t.match = best;
+        t.misses = 0;
+        if (t.hits < 255) t.hits++;
+    }
+    for (int d = 0; d < result.count; d++) {
+        if (taken[d]) continue;
+        for (int i = 0; i < TRACK_SLOTS; i++) {
+            Track &t = tracker.tracks[i];
+            if (t.used) continue;
+            t.used = true;
+            t.id = tracker.nextId++;
+            t.box = result.boxes[d];
+            t.match = d;
+            t.hits = 1;
+            t.misses = 0;
+            t.identity = ID_UNCHECKED;
+            t.idTries = 0;
+            t.alerted = false;
+            t.firstSeen = millis();
+            t.lastReport = 0;
+            tracker.created++;
+            break;
+        }
+    }
+}
+
+// Next confirmed track owing an alert or update, or nullptr.
+Track * nextTrackReport() {
+    for (int i = 0; i < TRACK_SLOTS; i++) {
+        Track &t = tracker.tracks[i];
+        if (!t.used || t.misses || t.hits < TRACK_CONFIRM_HITS) continue;
+        if (t.identity == ID_CHECKING || t.identity == ID_KNOWN) continue;
+        if (!t.alerted || millis() - t.lastReport >= TRACK_UPDATE_MS) return &t;
+    }
+    return nullptr;
+}
+
+void markTrackReported(Track * t) {
+    t->alerted = true;
+    t->lastReport = millis();
+}
+
+int confirmedTracks() {
+    int n = 0;
+    for (int i = 0; i < TRACK_SLOTS; i++) {
+        const Track &t = tracker.tracks[i];
+        if (t.used && t.hits >= TRACK_CONFIRM_HITS && t.identity != ID_KNOWN) n++;
+    }
+    return n;
+}
+
+// ==========================================================
+// ⚡ BURST WINDOW (HUB-TRIGGERED)
+// ==========================================================
+// A hub burst asks for detection on every frame, motion or not, for up to
+// BURST_MAX_MS. The first pass after it lands owes the hub an ack. Bursts
+// start from the hub uplinks on the camera and from --burst in replay.
+#define BURST_MAX_MS        10000   // However long a hub asks for
+
+struct BurstState {
+    bool seen = false;
+    uint16_t id = 0;
+    uint32_t start = 0;
+    uint32_t durationMs = 0;
+    int64_t rxUs = 0;
+    bool pendingAck = false;
+    uint32_t commands = 0;
+} burst;
+
+portMUX_TYPE burstMux = portMUX_INITIALIZER_UNLOCKED;
+
+bool burstActive() {
+    return burst.durationMs && millis() - burst.start < burst.durationMs;
+}
+
+// Open a burst window; false for a repeat of the last burst id.
+bool startBurst(uint16_t id, uint32_t durationMs) {
+    portENTER_CRITICAL(&burstMux);
+    bool repeat = burst.seen && burst.id == id;
+    if (!repeat) {
+        burst.seen = true;
+        burst.id = id;
+        burst.start = millis();
+        burst.durationMs = min(durationMs, (uint32_t)BURST_MAX_MS);
+        burst.rxUs = esp_timer_get_time();
+        burst.pendingAck = true;
+        burst.commands++;
+    }
+    portEXIT_CRITICAL(&burstMux);
+    return !repeat;
+}
+
+// ==========================================================
+// 🚨 ALERT DECISION
+// ==========================================================
+// One detector pass in, reports out: tracks are updated, the caller's
+// identify step settles known faces before anything is reported, a pending
+// burst is acked, then every confirmed track owing one gets its ALERT or
+// update. The firmware sends what the hooks hand it; replay prints it.
+struct DecisionHooks {
+    void (*identify)(dl_matrix3du_t * image, const DetectionResult &detections);   // nullptr: no recognition
+    void (*burstAck)(uint8_t detections);
+    void (*report)(Track * t, bool isNew, const DetectionResult &detections);
+};
+
+// Returns the confirmed tracks left after the pass (known faces excluded).
+int decideTracks(dl_matrix3du_t * image, const DetectionResult &detections, const DecisionHooks &hooks) {
+    updateTracks(detections);
+    if (hooks.identify) hooks.identify(image, detections);
+    if (burst.pendingAck) hooks.burstAck(detections.count);
+    int reports = 0;
+    for (Track * t = nextTrackReport(); t; t = nextTrackReport()) {
+        bool isNew = !t->alerted;
+        hooks.report(t, isNew, detections);
+        if (!isNew) tracker.updatesSent++;
+        markTrackReported(t);
+        reports++;
+    }
+    int confirmed = confirmedTracks();
+    if (confirmed && !reports) tracker.suppressed++;
+    return confirmed;
+}
+
+// ==========================================================
+// 🧠 NEURAL DETECTION
+// ==========================================================
+void runDetector(dl_matrix3du_t * input, mtmn_config_t * config, const RoiRect &r, float scale, uint8_t crop, DetectionResult &result) {
+    box_array_t *boxes = face_detect(input, config);
+    if (!boxes) return;
+    mergeBoxes(boxes, r, scale, crop, result);
+    free(boxes->score);
+    free(boxes->box);
+    free(boxes->landmark);
+    free(boxes);
+}
+
+// ROI mode: decode the frame straight into the motion crops, then run MTMN on each.
+bool detectRoiTargets(camera_fb_t * fb, DetectionResult &result, mtmn_config_t * config) {
+    int64_t stageStart = esp_timer_get_time();
+    RoiRect regions[ROI_MAX_REGIONS];
+    planRoiCrops(regions, buildMotionRegions(fb->width, fb->height, regions));
+    bool decoded = true;
+    if (fb->format == PIXFORMAT_JPEG) decoded = esp_jpg_decode(fb->len, roi.jpegScale, roiJpegReader, roiCropWriter, fb) == ESP_OK;
+    else if (fb->format == PIXFORMAT_RGB565) cropRgb565(fb);
+    else decoded = false;
+    stageTimes.decodeUs = esp_timer_get_time() - stageStart;
+    if (!decoded) {
+        roi.cropCount = 0;
+        return false;
+    }
+
+    stageStart = esp_timer_get_time();
+    roi.lastRegions = roi.cropCount;
+    roi.lastPixels = 0;
+    for (int k = 0; k < roi.cropCount; k++) {
+        RoiCrop &c = roi.crops[k];
+        roi.lastPixels += c.matrix.w * c.matrix.h;
+        runDetector(&c.matrix, config, c.rect, c.scale, k + 1, result);
+    }
+    stageTimes.detectUs = esp_timer_get_time() - stageStart;
+    return result.count > 0;
+}
+
+// With `keepImage` the decoded RGB888 frame is handed to the caller (who
+// must returnImageMatrix() it) instead of going straight back to the pool.
+// ROI mode never has a full frame; detectionImage() finds the crop instead.
+bool detectNeuralTarget(camera_fb_t * fb, DetectionResult &result, dl_matrix3du_t ** keepImage = nullptr) {
+    result.count = 0;
+    if (keepImage) *keepImage = nullptr;
+    if (!fb) return false;
+    imagePool.framePoolMisses = 0;
+
+    // Initialize MTMN Neural Configuration (Standard AI-Thinker Optimization)
+    mtmn_config_t config = mtmn_init_config();
+    if (roi.enabled) return detectRoiTargets(fb, result, &config);
+
+    // Borrow RGB Matrix for Face Analysis from the boot-time pool
+    dl_matrix3du_t *image_matrix = borrowImageMatrix(fb->width, fb->height);
+    if(!image_matrix) return false;
+    int64_t stageStart = esp_timer_get_time();
+
+    // JPEG is decoded; a raw RGB565 frame only needs its pixels widened
+    if(!fmt2rgb888(fb->buf, fb->len, fb->format, image_matrix->item)) {
+        returnImageMatrix(image_matrix);
+        return false;
+    }
+    stageTimes.decodeUs = esp_timer_get_time() - stageStart;
+
+    stageStart = esp_timer_get_time();
+    roi.lastRegions = 1;
+    roi.lastPixels = fb->width * fb->height;
+    runDetector(image_matrix, &config, {0, 0, (int)fb->width, (int)fb->height}, 1.0f, 0, result);
+    stageTimes.detectUs = esp_timer_get_time() - stageStart;
+    bool targetFound = result.count > 0;
+    
+    if (keepImage) *keepImage = image_matrix;
+    else returnImageMatrix(image_matrix);
+    if (imagePool.framePoolMisses > imagePool.peakFramePoolMisses) imagePool.peakFramePoolMisses = imagePool.framePoolMisses;
+    return targetFound;
+}
+
+// The image a detection can be aligned in, and the detection in that image's
+// pixels: the kept frame, or in ROI mode the crop it was found in (valid
+// until the next detectNeuralTarget call). Null if there is neither.
+dl_matrix3du_t * detectionImage(dl_matrix3du_t * frame, const Detection &d, Detection &local) {
+    local = d;
+    if (!d.crop) return frame;
+    RoiCrop &c = roi.crops[d.crop - 1];
+    local.x1 = (d.x1 - c.rect.x0) / c.scale;
+    local.y1 = (d.y1 - c.rect.y0) / c.scale;
+    local.x2 = (d.x2 - c.rect.x0) / c.scale;
+    local.y2 = (d.y2 - c.rect.y0) / c.scale;
+    for (int k = 0; k < 10; k++) local.landmarks[k] = (d.landmarks[k] - ((k & 1) ? c.rect.y0 : c.rect.x0)) / c.scale;
+    return &c.matrix;
+}
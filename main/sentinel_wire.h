@@ -0,0 +1,236 @@
+/**
+ * 🏔️ PYRAMID SENTINEL PRO - CAMERA WIRE FORMAT
+ *
+ * Shared by the cameras (writer) and the Neuro-Core (reader), for ESP-NOW
+ * frames and for the binary digests on the WebSocket uplink. Commands go
+ * the other way in the same framing, with camId 0 marking the hub. A frame is a
+ * WireHeader followed by `records` TLV records, packed little-endian, and
+ * never exceeds one ESP-NOW payload. Readers skip record types they do not
+ * know and accept records longer than the struct they expect, so fields can
+ * be appended without a version bump; layout changes bump WIRE_VERSION.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WIRE_MAGIC          0x53    // 'S'
+#define WIRE_VERSION        1
+#define WIRE_FRAME_MAX      250     // ESP_NOW_MAX_DATA_LEN
+#define WIRE_MAX_BOXES      4
+
+enum WireRecordType : uint8_t {
+    WIRE_HEARTBEAT  = 1,
+    WIRE_ALERT      = 2,
+    WIRE_STATS      = 3,
+    WIRE_TRACK      = 4,        // Throttled update of an alerted track (WireAlert payload)
+    WIRE_CLIP       = 5,
+    WIRE_BURST      = 6,        // Hub -> cameras: analyse at burst rate for a while
+    WIRE_BURST_ACK  = 7,        // Camera -> hub: first inference of a burst is done
+};
+
+#define WIRE_HUB_ID         0   // camId of frames sent by a hub
+
+struct __attribute__((packed)) WireHeader {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t camId;
+    uint8_t records;
+    uint16_t seq;               // Per-sender frame counter (wraps)
+    uint32_t sentMs;            // Sender millis() when the frame went out
+};
+
+struct __attribute__((packed)) WireRecordHeader {
+    uint8_t type;
+    uint8_t len;                // Payload bytes that follow
+};
+
+struct __attribute__((packed)) WireHeartbeat {
+    int16_t tempCenti;          // °C x 100
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;
+    uint8_t state;              // Camera CamState
+    uint32_t uptimeS;
+    uint8_t throttle;           // Thermal governor level, 0 = unthrottled
+    int16_t headroomCenti;      // °C x 100 below the camera's thermal limit
+    uint8_t coveragePct;        // Detection rate as % of unthrottled
+};
+
+struct __attribute__((packed)) WireBox {
+    uint16_t x1, y1, x2, y2;    // Frame pixels
+    uint8_t score;              // Detector score x 255
+};
+
+struct __attribute__((packed)) WireAlert {
+    uint32_t trackId;
+    uint32_t ageMs;
+    int16_t tempCenti;
+    uint8_t boxCount;           // Tracked box first, then the rest of the frame's detections
+    WireBox boxes[WIRE_MAX_BOXES];
+};
+
+struct __attribute__((packed)) WireStats {
+    uint32_t framesProcessed;
+    uint32_t alertsSent;
+    uint32_t gateHits;
+    uint32_t gateMisses;
+    uint32_t detectUs;          // Last frame's MTMN time
+    uint16_t detectFpsX10;
+    uint8_t tracks;             // Confirmed tracks in view
+};
+
+struct __attribute__((packed)) WireClip {
+    uint32_t trackId;
+    uint32_t clipId;            // Served by the camera on /clip?id=
+};
+
+struct __attribute__((packed)) WireBurst {
+    uint16_t burstId;           // Repeats of one command (ESP-NOW + WebSocket) share it
+    uint8_t cameraMask;         // Bit n = camera n
+    uint16_t durationMs;
+};
+
+struct __attribute__((packed)) WireBurstAck {
+    uint16_t burstId;
+    uint32_t rxToInferUs;       // Command received -> first burst inference done
+    uint8_t detections;
+};
+
+// ==========================================================
+// ✍️ WRITER (CAMERA)
+// ==========================================================
+struct WireWriter {
+    uint8_t buf[WIRE_FRAME_MAX];
+    size_t len = sizeof(WireHeader);
+    uint8_t records = 0;
+    uint16_t seq = 0;
+};
+
+inline void wireBegin(WireWriter &w) {
+    w.len = sizeof(WireHeader);
+    w.records = 0;
+}
+
+// Append one record; false (and nothing written) when the frame has no room.
+inline bool wireAppend(WireWriter &w, uint8_t type, const void * payload, size_t len) {
+    if (len > 255 || w.records == 255 || w.len + sizeof(WireRecordHeader) + len > WIRE_FRAME_MAX) return false;
+    WireRecordHeader rec = {type, (uint8_t) len};
+    memcpy(w.buf + w.len, &rec, sizeof(rec));
+    memcpy(w.buf + w.len + sizeof(rec), payload, len);
+    w.len += sizeof(rec) + len;
+    w.records++;
+    return true;
+}
+
+// Stamp the header; returns the number of bytes to send.
+inline size_t wireFinish(WireWriter &w, uint8_t camId, uint32_t nowMs) {
+    WireHeader hdr = {WIRE_MAGIC, WIRE_VERSION, camId, w.records, w.seq++, nowMs};
+    memcpy(w.buf, &hdr, sizeof(hdr));
+    return w.len;
+}
+
+// Bytes of a WireAlert carrying `boxes` boxes.
+inline size_t wireAlertSize(uint8_t boxes) {
+    return offsetof(WireAlert, boxes) + (size_t) boxes * sizeof(WireBox);
+}
+
+// ==========================================================
+// 📖 READER (NEURO-CORE)
+// ==========================================================
+enum WireStatus {
+    WIRE_OK,
+    WIRE_SHORT,                 // Smaller than a header
+    WIRE_BAD_MAGIC,
+    WIRE_BAD_VERSION,
+    WIRE_TRUNCATED,             // Records run past the end of the frame
+};
+
+struct WireRecord {
+    uint8_t type;
+    uint8_t len;
+    const uint8_t * data;
+};
+
+// Check a received frame and locate its records; nothing is trusted beyond `len`.
+inline WireStatus wireDecode(const uint8_t * data, int len, WireHeader &hdr, WireRecord * records, int maxRecords, int &count) {
+    count = 0;
+    if (!data || len < (int) sizeof(WireHeader)) return WIRE_SHORT;
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.magic != WIRE_MAGIC) return WIRE_BAD_MAGIC;
+    if (hdr.version != WIRE_VERSION) return WIRE_BAD_VERSION;
+    int off = sizeof(WireHeader);
+    for (int i = 0; i < hdr.records; i++) {
+        if (off + (int) sizeof(WireRecordHeader) > len) return WIRE_TRUNCATED;
+        WireRecordHeader rec;
+        memcpy(&rec, data + off, sizeof(rec));
+        off += sizeof(rec);
+        if (off + rec.len > len) return WIRE_TRUNCATED;
+        if (count < maxRecords) records[count++] = {rec.type, rec.len, data + off};
+        off += rec.len;
+    }
+    return WIRE_OK;
+}
+
+// Copy a fixed-size record; shorter than `minLen` is rejected, missing tail fields read as zero.
+template <typename T>
+inline bool wireRead(const WireRecord &r, T &out, size_t minLen = sizeof(T)) {
+    if (r.len < minLen) return false;
+    memset(&out, 0, sizeof(out));
+    memcpy(&out, r.data, r.len < sizeof(T) ? r.len : sizeof(T));
+    return true;
+}
+
+// Heartbeats from cameras older than the thermal governor stop before
+// `throttle`; they read as unthrottled at full coverage.
+inline bool wireReadHeartbeat(const WireRecord &r, WireHeartbeat &out) {
+    if (!wireRead(r, out, offsetof(WireHeartbeat, throttle))) return false;
+    if (r.len < offsetof(WireHeartbeat, coveragePct) + sizeof(out.coveragePct)) out.coveragePct = 100;
+    return true;
+}
+
+inline bool wireReadAlert(const WireRecord &r, WireAlert &out) {
+    if (!wireRead(r, out, offsetof(WireAlert, boxes))) return false;
+    if (out.boxCount > WIRE_MAX_BOXES || r.len < wireAlertSize(out.boxCount)) return false;
+    return true;
+}
+
+// ==========================================================
+// 🔢 LINK SEQUENCE (NEURO-CORE)
+// ==========================================================
+// Per-camera seq tracking. Duplicates and stale retransmits are dropped and
+// gaps count as lost frames. A camera that reboots restarts seq at 0, so a
+// sentMs that jumps back past WIRE_REORDER_MS, or a heartbeat uptime below
+// the last one, resyncs the link instead of looking like a stale frame.
+#define WIRE_REORDER_MS     2000    // Furthest a frame can arrive behind its successor
+
+struct WireLink {
+    bool seen = false;
+    uint16_t lastSeq = 0;
+    uint32_t lastSentMs = 0;    // Camera clock of its newest frame
+    uint32_t lastUptimeS = 0;
+    uint32_t frames = 0;
+    uint32_t lost = 0;
+    uint32_t restarts = 0;
+};
+
+// True if the frame is new; `hb` is its heartbeat, if it carries one.
+inline bool wireAcceptSeq(WireLink &link, const WireHeader &hdr, const WireHeartbeat * hb = nullptr) {
+    if (link.seen) {
+        uint32_t back = link.lastSentMs - hdr.sentMs;
+        bool restarted = (back > WIRE_REORDER_MS && back < 0x80000000u) || (hb && hb->uptimeS < link.lastUptimeS);
+        if (restarted) {
+            link.restarts++;
+        } else {
+            uint16_t gap = hdr.seq - link.lastSeq;
+            if (gap == 0 || gap > 0x8000) return false;    // Duplicate or stale retransmit
+            link.lost += gap - 1;
+        }
+    }
+    link.seen = true;
+    link.lastSeq = hdr.seq;
+    link.lastSentMs = hdr.sentMs;
+    if (hb) link.lastUptimeS = hb->uptimeS;
+    link.frames++;
+    return true;
+}
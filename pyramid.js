@@ -22,6 +22,10 @@ let CAM_IPS_RAW = JSON.parse(localStorage.getItem('pyramid_cam_ips')) || {
 };
 
 let ws = null;
+// Hub state as built from versioned state_update deltas
+let hubState = {};
+let hubStateVersion = 0;
+let snapshotRequested = false;   // One STATE_SNAPSHOT per gap, until the full state arrives
 
 let CAM_IPS = {};
 Object.keys(CAM_IPS_RAW).forEach(id => {
@@ -677,23 +681,45 @@ async function updateStatus() {
     }
 }
 
-// Load event logs
+// Load event logs: the newest page first, then only what follows the hub's
+// cursor, so a refresh moves a few hundred bytes instead of the whole log
+const LOG_PAGE = 100;
+const LOG_VIEW_MAX = 500;
+let logCursor = 0;
+let logsLoading = false;
+
 async function loadLogs() {
+    if (logsLoading) return;
+    logsLoading = true;
     try {
-        const res = await safeFetch(MAIN_IP + "/api/logs", {}, 2000);
-        if (!res) {
-            document.getElementById("logs").innerHTML = '<div class="log-entry">⚠️ No connection to main controller</div>';
-            return;
-        }
-        const txt = await res.text();
-        const entries = txt.split('\n').filter(l => l.trim());
-        const html = entries.map(line => `<div class="log-entry">${line}</div>`).join('');
-        document.getElementById("logs").innerHTML = html || '<div class="log-entry">No logs available</div>';
-
         const logsEl = document.getElementById("logs");
-        logsEl.scrollTop = logsEl.scrollHeight;
+        for (let page = 0; page < 5; page++) {
+            const query = logCursor ? `cursor=${logCursor}` : "";
+            const res = await safeFetch(`${MAIN_IP}/api/logs?format=json&limit=${LOG_PAGE}&${query}`, {}, 2000);
+            if (!res) {
+                if (!logCursor) logsEl.innerHTML = '<div class="log-entry">⚠️ No connection to main controller</div>';
+                return;
+            }
+            const data = await res.json();
+            if (!logCursor) logsEl.innerHTML = "";
+            const atBottom = logsEl.scrollTop + logsEl.clientHeight >= logsEl.scrollHeight - 4;
+            if (data.events.length) logsEl.querySelector(".log-empty")?.remove();
+            for (const ev of data.events) {
+                const div = document.createElement("div");
+                div.className = "log-entry";
+                div.textContent = `[${ev.ts}] ${ev.level} ${ev.msg}`;
+                logsEl.appendChild(div);
+            }
+            while (logsEl.children.length > LOG_VIEW_MAX) logsEl.firstChild.remove();
+            if (!logsEl.children.length) logsEl.innerHTML = '<div class="log-entry log-empty">No logs available</div>';
+            if (atBottom || !logCursor) logsEl.scrollTop = logsEl.scrollHeight;
+            logCursor = data.next;
+            if (!data.more) break;
+        }
     } catch (e) {
         console.error('Logs error:', e);
+    } finally {
+        logsLoading = false;
     }
 }
 
@@ -726,6 +752,13 @@ async function loadGallery() {
             if (files && Array.isArray(files) && files.length > 0) {
                 html += `<div style="width: 100%; font-size: 10px; color: var(--accent); margin: 10px 0;">📡 BRAIN CORE STORAGE (${files.length} ITEMS)</div>`;
                 files.forEach(f => {
+                    // Alert clips from the cameras: { cam, ts, url } pointing at a camera's /clip MJPEG
+                    if (f && typeof f === 'object') {
+                        const clipUrl = sanitizeInput(f.url);
+                        if (!clipUrl) return;
+                        html += `<img src="${clipUrl}" alt="CAM ${f.cam} clip" onclick="openImage('${clipUrl}')" title="Alert clip: CAM ${f.cam}" onerror="this.style.display='none'">`;
+                        return;
+                    }
                     const encoded = encodeURIComponent(f);
                     html += `<img src="${MAIN_IP}/captured/${encoded}" alt="${f}" onclick="openImage('${MAIN_IP}/captured/${encoded}')" title="${f}" onerror="this.style.display='none'">`;
                 });
@@ -797,13 +830,12 @@ async function snapshot(cam) {
     }
 
     try {
-        // Trigger capture on hardware
+        // /capture streams the JPEG straight from the camera frame buffer
         const res = await safeFetch(ip + "/capture", { method: 'GET' }, 8000);
 
         if (res && res.ok) {
             const contentType = res.headers.get("content-type");
             if (contentType && contentType.includes("image")) {
-                // If response is an image, update directly
                 const blob = await res.blob();
 
                 // Save to Local Database!
@@ -811,9 +843,6 @@ async function snapshot(cam) {
 
                 playSound();
                 // console.log(`✅ Snapshot from Cam ${cam} saved to LOCAL VAULT (optimized)`);
-            } else {
-                // Fallback: If it returns JSON or other status, maybe try fetching stream frame
-                // But for now we assume /capture returns image since we want to avoid double load
             }
         }
 
@@ -971,6 +1000,7 @@ function initWebSocket() {
 
     ws = new WebSocket(wsUrl);
     ws.binaryType = 'blob';
+    snapshotRequested = false;
 
     ws.onmessage = async (event) => {
         try {
@@ -985,13 +1015,24 @@ function initWebSocket() {
                 }
 
                 if (data.event === "state_update") {
-                    document.getElementById("tileSystem").innerText = data.armed ? "ARMED" : "DISARMED";
-                    document.getElementById("tileAlert").innerText = data.log || "NONE";
-                    document.getElementById("tileActivity").innerText = data.prox > 0 ? `OBJ @ ${data.prox}cm` : "CLEAR";
-                    document.getElementById("sysStatus").innerText = data.armed ? "🔒 ARMED" : "🔓 DISARMED";
+                    // Deltas carry only changed fields; a gap in `v` means one was missed
+                    if (!data.full && data.v !== hubStateVersion + 1) {
+                        if (!snapshotRequested) ws.send(JSON.stringify({ command: "STATE_SNAPSHOT" }));
+                        snapshotRequested = true;
+                        return;
+                    }
+                    if (data.full) snapshotRequested = false;
+                    const logChanged = data.log !== undefined && data.log !== hubState.log;
+                    hubState = data.full ? { ...data } : { ...hubState, ...data };
+                    hubStateVersion = data.v;
+
+                    document.getElementById("tileSystem").innerText = hubState.armed ? "ARMED" : "DISARMED";
+                    document.getElementById("tileAlert").innerText = hubState.log || "NONE";
+                    document.getElementById("tileActivity").innerText = hubState.prox > 0 ? `OBJ @ ${hubState.prox}cm` : "CLEAR";
+                    document.getElementById("sysStatus").innerText = hubState.armed ? "🔒 ARMED" : "🔓 DISARMED";
 
                     // If there's a fresh log entry in the websocket
-                    if (data.log && data.log !== "KERNEL_BOOT") {
+                    if (logChanged && hubState.log !== "KERNEL_BOOT") {
                         loadLogs();
                     }
                 }
@@ -0,0 +1,31 @@
+/**
+ * Host stand-in for the parts of the Arduino-ESP32 core the neural pipeline
+ * uses. millis() follows the replay clock, so gate refreshes and track
+ * throttling see recorded time rather than how fast the host runs.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+using std::min;
+using std::max;
+using std::abs;
+
+unsigned long millis();
+
+// Single-threaded replay: critical sections have nothing to exclude
+struct portMUX_TYPE { int unused; };
+#define portMUX_INITIALIZER_UNLOCKED {0}
+inline void portENTER_CRITICAL(portMUX_TYPE *) {}
+inline void portEXIT_CRITICAL(portMUX_TYPE *) {}
+
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_8BIT     (1 << 2)
+inline void * heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void * heap_caps_calloc(size_t n, size_t size, uint32_t) { return calloc(n, size); }
+inline void heap_caps_free(void * p) { free(p); }
+inline bool psramFound() { return true; }
@@ -0,0 +1,32 @@
+/**
+ * Host stand-in for the esp32-camera types the neural pipeline touches.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+typedef enum {
+    PIXFORMAT_RGB565, PIXFORMAT_YUV422, PIXFORMAT_YUV420, PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG, PIXFORMAT_RGB888
+} pixformat_t;
+
+typedef enum {
+    FRAMESIZE_96X96, FRAMESIZE_QQVGA, FRAMESIZE_QCIF, FRAMESIZE_HQVGA, FRAMESIZE_240X240,
+    FRAMESIZE_QVGA, FRAMESIZE_CIF, FRAMESIZE_HVGA, FRAMESIZE_VGA, FRAMESIZE_SVGA,
+    FRAMESIZE_XGA, FRAMESIZE_HD, FRAMESIZE_SXGA, FRAMESIZE_UXGA, FRAMESIZE_INVALID
+} framesize_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+} resolution_info_t;
+
+extern const resolution_info_t resolution[];
+
+typedef struct {
+    uint8_t * buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+} camera_fb_t;
@@ -0,0 +1,20 @@
+/**
+ * Host stand-in for the esp32-camera block decoder the ROI path uses.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#ifndef ESP_OK
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#endif
+
+typedef enum { JPG_SCALE_NONE, JPG_SCALE_2X, JPG_SCALE_4X, JPG_SCALE_8X } jpg_scale_t;
+
+typedef size_t (* jpg_reader_cb)(void * arg, size_t index, uint8_t * buf, size_t len);
+typedef bool (* jpg_writer_cb)(void * arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t * data);
+
+// Decoded with libjpeg and handed to `writer` one RGB888 row at a time
+esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg);
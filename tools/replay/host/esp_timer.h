@@ -0,0 +1,5 @@
+#pragma once
+#include <cstdint>
+
+// Real monotonic time in microseconds; stage latencies are measured with it
+int64_t esp_timer_get_time();
@@ -0,0 +1,56 @@
+/**
+ * Host stand-in for the esp-face MTMN interface. Layouts follow esp-face so
+ * a host build of the real detector can be linked in (REPLAY_ESP_FACE_LIB);
+ * otherwise face_detect() goes to whichever replay detector is selected.
+ */
+#pragma once
+#include <cstdint>
+
+typedef uint8_t uc_t;
+typedef float fptp_t;
+
+typedef struct {
+    int w, h, c, n, stride;
+    uc_t * item;
+} dl_matrix3du_t;
+
+typedef struct {
+    fptp_t box_p[4];
+} box_t;
+
+typedef struct {
+    fptp_t landmark_p[10];
+} landmark_t;
+
+typedef struct tag_box_list {
+    fptp_t * score;
+    box_t * box;
+    landmark_t * landmark;
+    int len;
+} box_array_t;
+
+typedef struct {
+    fptp_t score;
+    fptp_t nms;
+    int candidate_number;
+} threshold_config_t;
+
+typedef struct {
+    int type;
+    fptp_t min_face;
+    fptp_t pyramid;
+    int pyramid_times;
+    threshold_config_t p_threshold;
+    threshold_config_t r_threshold;
+    threshold_config_t o_threshold;
+} mtmn_config_t;
+
+extern "C" {
+dl_matrix3du_t * dl_matrix3du_alloc(int n, int w, int h, int c);
+void dl_matrix3du_free(dl_matrix3du_t * m);
+mtmn_config_t mtmn_init_config();
+}
+
+// The pipeline's face_detect() is routed to the replay detector registry
+#define face_detect replay_face_detect
+box_array_t * replay_face_detect(dl_matrix3du_t * image, mtmn_config_t * config);
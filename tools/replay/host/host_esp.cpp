@@ -0,0 +1,179 @@
+/**
+ * Host implementations behind the stand-in ESP32 headers: the resolution
+ * table, clocks, libjpeg-backed converters and dl_matrix allocation.
+ */
+#include <chrono>
+#include <csetjmp>
+#include <cstdio>
+#include <vector>
+#include <jpeglib.h>
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "img_converters.h"
+#include "fd_forward.h"
+#include "../replay.h"
+
+const resolution_info_t resolution[] = {
+    {96, 96}, {160, 120}, {176, 144}, {240, 176}, {240, 240},
+    {320, 240}, {400, 296}, {480, 320}, {640, 480}, {800, 600},
+    {1024, 768}, {1280, 720}, {1280, 1024}, {1600, 1200},
+};
+
+unsigned long replayClockMs = 0;
+
+unsigned long millis() {
+    return replayClockMs;
+}
+
+int64_t esp_timer_get_time() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ==========================================================
+// 🖼️ JPEG DECODE (LIBJPEG)
+// ==========================================================
+struct JpegError {
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr cinfo) {
+    longjmp(((JpegError *) cinfo->err)->jump, 1);
+}
+
+// Decode `src` at 1/scale, handing each RGB row to `row`. False on a corrupt stream.
+template <typename RowFn>
+static bool decodeJpeg(const uint8_t * src, size_t len, int scale, RowFn row) {
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpegErrorExit;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *) src, len);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale;
+    jpeg_start_decompress(&cinfo);
+    uint8_t * line = (uint8_t *) malloc(cinfo.output_width * 3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        int y = cinfo.output_scanline;
+        jpeg_read_scanlines(&cinfo, &line, 1);
+        row(y, line, (int) cinfo.output_width);
+    }
+    free(line);
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+bool jpegDimensions(const uint8_t * src, size_t len, int &w, int &h) {
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpegErrorExit;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *) src, len);
+    jpeg_read_header(&cinfo, TRUE);
+    w = cinfo.image_width;
+    h = cinfo.image_height;
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+// esp-face expects BGR888, as produced by the esp32-camera converter
+bool fmt2rgb888(const uint8_t * src, size_t len, pixformat_t format, uint8_t * rgb) {
+    if (format == PIXFORMAT_RGB565) {
+        for (size_t i = 0; i < len / 2; i++) {
+            uint16_t c = (src[i * 2] << 8) | src[i * 2 + 1];
+            rgb[i * 3] = (c << 3) & 0xF8;
+            rgb[i * 3 + 1] = (c >> 3) & 0xFC;
+            rgb[i * 3 + 2] = (c >> 8) & 0xF8;
+        }
+        return true;
+    }
+    if (format != PIXFORMAT_JPEG) return false;
+    return decodeJpeg(src, len, 1, [&](int y, const uint8_t * line, int w) {
+        uint8_t * o = rgb + (size_t) y * w * 3;
+        for (int x = 0; x < w; x++) {
+            o[x * 3] = line[x * 3 + 2];
+            o[x * 3 + 1] = line[x * 3 + 1];
+            o[x * 3 + 2] = line[x * 3];
+        }
+    });
+}
+
+// Big-endian RGB565, as produced by the esp32-camera converter
+bool jpg2rgb565(const uint8_t * src, size_t len, uint8_t * out, jpg_scale_t scale) {
+    return decodeJpeg(src, len, 1 << scale, [&](int y, const uint8_t * line, int w) {
+        uint8_t * o = out + (size_t) y * w * 2;
+        for (int x = 0; x < w; x++) {
+            uint16_t c = ((line[x * 3] & 0xF8) << 8) | ((line[x * 3 + 1] & 0xFC) << 3) | (line[x * 3 + 2] >> 3);
+            o[x * 2] = c >> 8;
+            o[x * 2 + 1] = c & 0xFF;
+        }
+    });
+}
+
+// Pulls the whole stream through `reader` first, as the device decoder reads it in pieces
+esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void * arg) {
+    std::vector<uint8_t> src(len);
+    if (reader(arg, 0, src.data(), len) != len) return ESP_FAIL;
+    writer(arg, 0, 0, 0, 0, nullptr);
+    bool ok = decodeJpeg(src.data(), len, 1 << scale, [&](int y, const uint8_t * line, int w) {
+        writer(arg, 0, y, w, 1, (uint8_t *) line);
+    });
+    writer(arg, 0, 0, 0, 0, nullptr);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+// ==========================================================
+// 🧮 DL MATRIX (ESP-FACE STAND-IN)
+// ==========================================================
+#ifndef REPLAY_HAVE_MTMN
+extern "C" dl_matrix3du_t * dl_matrix3du_alloc(int n, int w, int h, int c) {
+    dl_matrix3du_t * m = (dl_matrix3du_t *) calloc(1, sizeof(dl_matrix3du_t));
+    if (!m) return nullptr;
+    m->item = (uc_t *) malloc((size_t) n * w * h * c);
+    if (!m->item) {
+        free(m);
+        return nullptr;
+    }
+    m->n = n;
+    m->w = w;
+    m->h = h;
+    m->c = c;
+    m->stride = w * c;
+    return m;
+}
+
+extern "C" void dl_matrix3du_free(dl_matrix3du_t * m) {
+    if (!m) return;
+    free(m->item);
+    free(m);
+}
+
+// Same defaults the esp32-camera face detection example uses
+extern "C" mtmn_config_t mtmn_init_config() {
+    mtmn_config_t config = {};
+    config.type = 0;
+    config.min_face = 80;
+    config.pyramid = 0.707f;
+    config.pyramid_times = 4;
+    config.p_threshold = {0.6f, 0.7f, 20};
+    config.r_threshold = {0.7f, 0.7f, 10};
+    config.o_threshold = {0.7f, 0.7f, 1};
+    return config;
+}
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+#include "esp_camera.h"
+#include "esp_jpg_decode.h"
+
+// Decoded with libjpeg; output layouts match the esp32-camera converters
+bool fmt2rgb888(const uint8_t * src, size_t len, pixformat_t format, uint8_t * rgb);
+bool jpg2rgb565(const uint8_t * src, size_t len, uint8_t * out, jpg_scale_t scale);
@@ -0,0 +1,373 @@
+/**
+ * 🏔️ PYRAMID SENTINEL PRO - OFFLINE REPLAY HARNESS
+ *
+ * Runs the camera's neural pipeline (main/neural_pipeline.h) over a
+ * directory of recorded JPEGs on Linux, stage by stage as NeuralKernel does:
+ * capture -> motion gate -> decode -> detect -> track/alert decision.
+ *
+ * Usage: sentinel-replay <jpeg-dir> [--detector NAME] [--fps N] [--burst FRAME[:MS]] [--raw] [--quiet]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+
+#include "neural_pipeline.h"
+#include "replay.h"
+
+// ==========================================================
+// 🧪 DETECTOR BACKENDS
+// ==========================================================
+// The pipeline's face_detect() lands here and goes to the selected backend.
+// "sidecar" replays hand-labelled boxes from <frame>.txt ("x1 y1 x2 y2" per
+// line, frame pixels) and, like MTMN, cannot see a face narrower than
+// min_face in the image it is given, so ROI crops change what it finds.
+typedef box_array_t * (*DetectorFn)(dl_matrix3du_t * image, mtmn_config_t * config);
+
+struct DetectorEntry {
+    const char * name;
+    DetectorFn fn;
+    const char * help;
+};
+
+std::vector<Detection> frameTruth;      // Sidecar boxes of the frame being replayed
+std::vector<bool> frameKnown;           // Sidecar boxes labelled "known" (an enrolled face)
+
+box_array_t * allocBoxes(int len) {
+    box_array_t * boxes = (box_array_t *) calloc(1, sizeof(box_array_t));
+    boxes->len = len;
+    boxes->score = (fptp_t *) calloc(len, sizeof(fptp_t));
+    boxes->box = (box_t *) calloc(len, sizeof(box_t));
+    boxes->landmark = (landmark_t *) calloc(len, sizeof(landmark_t));
+    return boxes;
+}
+
+box_array_t * detectNone(dl_matrix3du_t *, mtmn_config_t *) {
+    return nullptr;
+}
+
+box_array_t * detectSidecar(dl_matrix3du_t * image, mtmn_config_t * config) {
+    // Where this image sits in the frame: the whole frame or the current ROI crop
+    float ox = 0, oy = 0, scale = 1.0f;
+    for (int k = 0; k < roi.cropCount; k++) {
+        if (image != &roi.crops[k].matrix) continue;
+        ox = roi.crops[k].rect.x0;
+        oy = roi.crops[k].rect.y0;
+        scale = roi.crops[k].scale;
+    }
+    std::vector<Detection> seen;
+    for (const Detection &d : frameTruth) {
+        float cx = ((d.x1 + d.x2) / 2.0f - ox) / scale;
+        float cy = ((d.y1 + d.y2) / 2.0f - oy) / scale;
+        if (cx < 0 || cy < 0 || cx >= image->w || cy >= image->h) continue;
+        if ((d.x2 - d.x1) / scale < config->min_face) continue;
+        seen.push_back(d);
+    }
+    if (seen.empty()) return nullptr;
+    box_array_t * boxes = allocBoxes(seen.size());
+    for (size_t i = 0; i < seen.size(); i++) {
+        boxes->box[i].box_p[0] = (seen[i].x1 - ox) / scale;
+        boxes->box[i].box_p[1] = (seen[i].y1 - oy) / scale;
+        boxes->box[i].box_p[2] = (seen[i].x2 - ox) / scale;
+        boxes->box[i].box_p[3] = (seen[i].y2 - oy) / scale;
+        boxes->score[i] = seen[i].score;
+    }
+    return boxes;
+}
+
+#ifdef REPLAY_HAVE_MTMN
+#undef face_detect
+extern "C" box_array_t * face_detect(dl_matrix3du_t * image, mtmn_config_t * config);
+
+box_array_t * detectMtmn(dl_matrix3du_t * image, mtmn_config_t * config) {
+    return face_detect(image, config);
+}
+#endif
+
+const DetectorEntry detectors[] = {
+    {"sidecar", detectSidecar, "labelled boxes from <frame>.txt, limited by min_face"},
+    {"none", detectNone, "never finds a face (gate + decode cost only)"},
+#ifdef REPLAY_HAVE_MTMN
+    {"mtmn", detectMtmn, "esp-face MTMN built for the host (REPLAY_ESP_FACE_LIB)"},
+#endif
+};
+
+DetectorFn activeDetector = detectSidecar;
+
+box_array_t * replay_face_detect(dl_matrix3du_t * image, mtmn_config_t * config) {
+    return activeDetector(image, config);
+}
+
+// ==========================================================
+// 📊 STAGE HISTOGRAMS
+// ==========================================================
+enum Stage { STAGE_CAPTURE, STAGE_GATE, STAGE_DECODE, STAGE_DETECT, STAGE_DECISION, STAGE_COUNT };
+const char * stageNames[STAGE_COUNT] = {"capture", "gate", "decode", "detect", "decision"};
+std::vector<uint32_t> stageSamples[STAGE_COUNT];
+
+uint32_t percentile(std::vector<uint32_t> &sorted, float p) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+void printHistograms() {
+    printf("\n%-9s %7s %9s %9s %9s %9s %9s   (us)\n", "stage", "n", "mean", "p50", "p90", "p99", "max");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        std::vector<uint32_t> v = stageSamples[s];
+        std::sort(v.begin(), v.end());
+        uint64_t sum = 0;
+        for (uint32_t x : v) sum += x;
+        printf("%-9s %7zu %9llu %9u %9u %9u %9u\n", stageNames[s], v.size(),
+               (unsigned long long)(v.empty() ? 0 : sum / v.size()),
+               percentile(v, 0.5f), percentile(v, 0.9f), percentile(v, 0.99f), v.empty() ? 0 : v.back());
+    }
+    // Power-of-two buckets: "<=N" counts samples up to N us
+    printf("\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        if (stageSamples[s].empty()) continue;
+        uint32_t buckets[32] = {0};
+        for (uint32_t x : stageSamples[s]) {
+            int b = 0;
+            while (b < 31 && (1u << b) < x) b++;
+            buckets[b]++;
+        }
+        printf("%-9s", stageNames[s]);
+        for (int b = 0; b < 32; b++) {
+            if (buckets[b]) printf(" <=%u:%u", 1u << b, buckets[b]);
+        }
+        printf("\n");
+    }
+}
+
+// ==========================================================
+// 🎞️ RECORDING
+// ==========================================================
+bool hasJpegExtension(const std::string &name) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string ext = name.substr(dot + 1);
+    for (char &c : ext) c = tolower(c);
+    return ext == "jpg" || ext == "jpeg";
+}
+
+std::vector<std::string> listFrames(const char * dir) {
+    std::vector<std::string> frames;
+    DIR * d = opendir(dir);
+    if (!d) return frames;
+    while (dirent * e = readdir(d)) {
+        if (hasJpegExtension(e->d_name)) frames.push_back(std::string(dir) + "/" + e->d_name);
+    }
+    closedir(d);
+    std::sort(frames.begin(), frames.end());
+    return frames;
+}
+
+bool readFile(const std::string &path, std::vector<uint8_t> &out) {
+    FILE * f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    out.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    return ok;
+}
+
+void loadSidecar(const std::string &frame) {
+    frameTruth.clear();
+    frameKnown.clear();
+    std::string path = frame.substr(0, frame.rfind('.')) + ".txt";
+    FILE * f = fopen(path.c_str(), "r");
+    if (!f) return;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        Detection d = {0, 0, 0, 0, 1.0f, {}, 0};
+        char label[16] = "";
+        if (sscanf(line, "%d %d %d %d %f %15s", &d.x1, &d.y1, &d.x2, &d.y2, &d.score, label) < 4) continue;
+        frameTruth.push_back(d);
+        frameKnown.push_back(!strcmp(label, "known"));
+    }
+    fclose(f);
+}
+
+// Smallest sensor frame size the recording fits in, as the firmware would boot with
+framesize_t framesizeFor(int w, int h) {
+    for (int s = 0; s < FRAMESIZE_INVALID; s++) {
+        if (resolution[s].width >= w && resolution[s].height >= h) return (framesize_t) s;
+    }
+    return FRAMESIZE_UXGA;
+}
+
+// ==========================================================
+// 🚨 DECISION HOOKS
+// ==========================================================
+// decideTracks() runs as in NeuralKernel; these stand in for its recognition
+// and uplinks. Recognition is the sidecar's "known" label on the box a
+// newly confirmed track matched, settled once per track like identifyTracks.
+size_t replayFrame = 0;
+bool replayQuiet = false;
+uint32_t alertsSent = 0, burstAcks = 0;
+
+void replayIdentify(dl_matrix3du_t *, const DetectionResult &detections) {
+    for (int i = 0; i < TRACK_SLOTS; i++) {
+        Track &t = tracker.tracks[i];
+        if (!t.used || t.hits < TRACK_CONFIRM_HITS) continue;
+        if (t.identity != ID_UNCHECKED || t.match < 0) continue;
+        t.identity = ID_STRANGER;
+        for (size_t k = 0; k < frameTruth.size(); k++) {
+            if (frameKnown[k] && boxIoU(frameTruth[k], detections.boxes[t.match]) >= TRACK_MATCH_IOU) t.identity = ID_KNOWN;
+        }
+        if (t.identity == ID_KNOWN && !replayQuiet) printf("KNOWN  frame %zu t=%lums track %u suppressed\n", replayFrame, millis(), t.id);
+    }
+}
+
+void replayBurstAck(uint8_t detections) {
+    burst.pendingAck = false;
+    burstAcks++;
+    if (!replayQuiet) printf("BURST  frame %zu t=%lums burst %u ack, %u detections\n", replayFrame, millis(), burst.id, detections);
+}
+
+void replayReport(Track * t, bool isNew, const DetectionResult &) {
+    if (isNew) alertsSent++;
+    if (replayQuiet) return;
+    printf("%-6s frame %zu t=%lums track %u box [%d,%d,%d,%d] age %lums\n", isNew ? "ALERT" : "UPDATE",
+           replayFrame, millis(), t->id, t->box.x1, t->box.y1, t->box.x2, t->box.y2, millis() - t->firstSeen);
+}
+
+// ==========================================================
+// 🚀 REPLAY DRIVER
+// ==========================================================
+void usage() {
+    fprintf(stderr, "usage: sentinel-replay <jpeg-dir> [--detector NAME] [--fps N] [--burst FRAME[:MS]] [--raw] [--quiet]\n");
+    fprintf(stderr, "  --fps N      recorded frame rate, drives the pipeline clock (default 3)\n");
+    fprintf(stderr, "  --burst F:MS a hub burst lands at frame F for MS ms (default BURST_MAX_MS); repeatable\n");
+    fprintf(stderr, "  --raw        hand the pipeline RGB565 frames, as a rawCapture sensor does\n");
+    fprintf(stderr, "  --quiet      only print the summary\n");
+    fprintf(stderr, "detectors:\n");
+    for (const DetectorEntry &d : detectors) fprintf(stderr, "  %-8s %s\n", d.name, d.help);
+}
+
+int main(int argc, char ** argv) {
+    const char * dir = nullptr;
+    float fps = 3;
+    bool raw = false;
+    std::vector<std::pair<size_t, uint32_t>> bursts;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--detector") && i + 1 < argc) {
+            const char * name = argv[++i];
+            activeDetector = nullptr;
+            for (const DetectorEntry &d : detectors) {
+                if (!strcmp(d.name, name)) activeDetector = d.fn;
+            }
+            if (!activeDetector) {
+                fprintf(stderr, "unknown detector '%s'\n", name);
+                usage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+            fps = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--burst") && i + 1 < argc) {
+            unsigned long frame = 0, ms = BURST_MAX_MS;
+            if (sscanf(argv[++i], "%lu:%lu", &frame, &ms) < 1) {
+                usage();
+                return 2;
+            }
+            bursts.push_back({frame, (uint32_t) ms});
+        } else if (!strcmp(argv[i], "--raw")) {
+            raw = true;
+        } else if (!strcmp(argv[i], "--quiet")) {
+            replayQuiet = true;
+        } else if (argv[i][0] != '-' && !dir) {
+            dir = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (!dir || fps <= 0) {
+        usage();
+        return 2;
+    }
+
+    std::vector<std::string> frames = listFrames(dir);
+    if (frames.empty()) {
+        fprintf(stderr, "no .jpg frames in %s\n", dir);
+        return 1;
+    }
+
+    std::vector<uint8_t> jpeg;
+    std::vector<uint8_t> rgb565;
+    int w = 0, h = 0;
+    if (!readFile(frames[0], jpeg) || !jpegDimensions(jpeg.data(), jpeg.size(), w, h)) {
+        fprintf(stderr, "cannot read %s\n", frames[0].c_str());
+        return 1;
+    }
+    framesize_t size = framesizeFor(w, h);
+    if (ROI_DETECTION) initRoiDetector();
+    if (!roi.enabled) initImagePool(size);
+    initMotionGate(size);
+    printf("replaying %zu frames (%dx%d, %s) at %.1f fps, ROI_DETECTION=%d\n", frames.size(), w, h,
+           raw ? "rgb565" : "jpeg", fps, ROI_DETECTION);
+
+    DetectionResult detections;
+    DecisionHooks hooks = {replayIdentify, replayBurstAck, replayReport};
+    uint32_t detectorPasses = 0, unreadable = 0;
+    int64_t replayStart = esp_timer_get_time();
+    for (size_t n = 0; n < frames.size(); n++) {
+        replayFrame = n;
+        replayClockMs = (unsigned long)(n * 1000.0f / fps);
+        stageTimes.gateUs = stageTimes.decodeUs = stageTimes.detectUs = 0;
+        for (size_t b = 0; b < bursts.size(); b++) {
+            if (bursts[b].first == n) startBurst(b + 1, bursts[b].second);
+        }
+
+        // Capture: the JPEG lands in a frame buffer, as esp_camera_fb_get() would hand it over
+        int64_t stageStart = esp_timer_get_time();
+        if (!readFile(frames[n], jpeg) || !jpegDimensions(jpeg.data(), jpeg.size(), w, h)) {
+            unreadable++;
+            continue;
+        }
+        camera_fb_t fb = {jpeg.data(), jpeg.size(), (size_t) w, (size_t) h, PIXFORMAT_JPEG};
+        loadSidecar(frames[n]);
+        stageTimes.captureUs = esp_timer_get_time() - stageStart;
+        if (raw) {
+            // The sensor would have delivered these pixels; unpacking the recording is not pipeline cost
+            rgb565.resize((size_t) w * h * 2);
+            if (!jpg2rgb565(jpeg.data(), jpeg.size(), rgb565.data(), JPG_SCALE_NONE)) {
+                unreadable++;
+                continue;
+            }
+            fb = {rgb565.data(), rgb565.size(), (size_t) w, (size_t) h, PIXFORMAT_RGB565};
+        }
+        stageSamples[STAGE_CAPTURE].push_back(stageTimes.captureUs);
+
+        stageStart = esp_timer_get_time();
+        bool moving = motionGatePass(&fb) || burstActive();
+        stageTimes.gateUs = esp_timer_get_time() - stageStart;
+        stageSamples[STAGE_GATE].push_back(stageTimes.gateUs);
+        if (!moving) continue;
+
+        detectNeuralTarget(&fb, detections);
+        detectorPasses++;
+        stageSamples[STAGE_DECODE].push_back(stageTimes.decodeUs);
+        stageSamples[STAGE_DETECT].push_back(stageTimes.detectUs);
+
+        stageStart = esp_timer_get_time();
+        decideTracks(nullptr, detections, hooks);
+        stageSamples[STAGE_DECISION].push_back(esp_timer_get_time() - stageStart);
+    }
+    double wallS = (esp_timer_get_time() - replayStart) / 1e6;
+
+    size_t replayed = frames.size() - unreadable;
+    printf("\nframes %zu  unreadable %u  gated static %u  detector passes %u\n",
+           frames.size(), unreadable, motionGate.misses, detectorPasses);
+    printf("alerts %u  track updates %u  tracks created %u  suppressed %u  burst acks %u\n",
+           alertsSent, tracker.updatesSent, tracker.created, tracker.suppressed, burstAcks);
+    printf("pool hits %u misses %u  roi regions (last) %d  roi pixels (last) %u\n", imagePool.hits, imagePool.misses, roi.lastRegions, roi.lastPixels);
+    printf("throughput %.1f frames/s (%.2f s wall)\n", wallS > 0 ? replayed / wallS : 0, wallS);
+    printHistograms();
+    return 0;
+}
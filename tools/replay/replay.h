@@ -0,0 +1,15 @@
+/**
+ * 🏔️ PYRAMID SENTINEL PRO - OFFLINE REPLAY HARNESS
+ *
+ * Glue between the replay driver and the host stand-ins for the ESP32 APIs.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Replay clock driving millis(): recorded time of the frame being processed
+extern unsigned long replayClockMs;
+
+// Read width/height from a JPEG header; false if it is not a readable JPEG
+bool jpegDimensions(const uint8_t * src, size_t len, int &w, int &h);
@@ -0,0 +1,79 @@
+/**
+ * 🏔️ PYRAMID SENTINEL PRO - WIRE FORMAT CHECKS
+ *
+ * Host checks for main/sentinel_wire.h: frames written by a camera are
+ * decoded and sequence-tracked the way EspNowIngestTask does it.
+ *
+ * Usage: sentinel-wire-check   (exit status 0 when every check passes)
+ */
+#include <cstdio>
+
+#include "sentinel_wire.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// One camera frame with seq `seq` sent at camera time `sentMs`, through the decoder and the tracker.
+static bool deliver(WireLink &link, uint16_t seq, uint32_t sentMs, const WireHeartbeat * hb = nullptr) {
+    WireWriter w;
+    w.seq = seq;
+    wireBegin(w);
+    if (hb) wireAppend(w, WIRE_HEARTBEAT, hb, sizeof(*hb));
+    size_t len = wireFinish(w, 1, sentMs);
+    WireHeader hdr;
+    WireRecord records[4];
+    int count = 0;
+    if (wireDecode(w.buf, (int) len, hdr, records, 4, count) != WIRE_OK) return false;
+    WireHeartbeat rx;
+    bool hasHb = count && records[0].type == WIRE_HEARTBEAT && wireReadHeartbeat(records[0], rx);
+    return wireAcceptSeq(link, hdr, hasHb ? &rx : nullptr);
+}
+
+static void checkInOrderAndGaps() {
+    WireLink link;
+    CHECK(deliver(link, 10, 1000));
+    CHECK(deliver(link, 11, 1100));
+    CHECK(!deliver(link, 11, 1100));        // Duplicate
+    CHECK(deliver(link, 14, 1400));
+    CHECK(link.lost == 2);
+    CHECK(!deliver(link, 12, 1200));        // Late retransmit
+    CHECK(link.frames == 3 && link.restarts == 0);
+}
+
+static void checkRestartBySentMs() {
+    WireLink link;
+    CHECK(deliver(link, 499, 600000));
+    CHECK(deliver(link, 500, 600100));
+    CHECK(deliver(link, 0, 3000));          // Rebooted: seq and clock start over
+    CHECK(deliver(link, 1, 3100));
+    CHECK(link.restarts == 1 && link.lost == 0 && link.lastSeq == 1);
+}
+
+static void checkRestartByUptime() {
+    // A reboot quick enough that sentMs still looks forward is caught by the heartbeat
+    WireLink link;
+    WireHeartbeat hb = {};
+    hb.uptimeS = 1;
+    CHECK(deliver(link, 500, 1500, &hb));
+    hb.uptimeS = 0;
+    CHECK(deliver(link, 0, 1600, &hb));
+    CHECK(link.restarts == 1 && link.lost == 0);
+}
+
+static void checkClockWrap() {
+    // millis() wrapping forward is not a restart
+    WireLink link;
+    CHECK(deliver(link, 7, 0xFFFFFF00u));
+    CHECK(deliver(link, 8, 0x00000100u));
+    CHECK(link.restarts == 0 && link.lost == 0);
+}
+
+int main() {
+    checkInOrderAndGaps();
+    checkRestartBySentMs();
+    checkRestartByUptime();
+    checkClockWrap();
+    printf("%s\n", failures ? "wire checks FAILED" : "wire checks ok");
+    return failures ? 1 : 0;
+}